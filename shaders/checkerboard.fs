@@ -1,12 +1,6 @@
 #version 330 core
 
-// these are here so the gui shows a color picker, sliders etc
-#define color3 vec3
-#define color4 vec4
-#define slider(a,b) float
-#define slider2(a,b) vec2
-#define slider3(a,b) vec3
-#define slider4(a,b) vec4
+#include "include/gui_types.glsl"
 
 in vec2 fragTexCoord;
 
@@ -0,0 +1,322 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <raylib.h>
+#include <rlgl.h>
+#include <external/glad.h>
+
+#include "AnimatedTexture.hpp"
+
+// upper bound on how far an image sequence is probed for its length
+#define MAX_SEQUENCE_FRAMES (1<<20)
+
+std::map<unsigned int, AnimatedTexture*> animatedTextures;
+
+// split a trailing "@fps" specifier off the source string
+static std::string SplitPlaybackRate(std::string str, float* fps) {
+    size_t at = str.find_last_of('@');
+    *fps = 0;
+    if (at == std::string::npos || at+1 >= str.length()) {
+        return str;
+    }
+    for (size_t i=at+1; i<str.length(); i++) {
+        if (!isdigit(str[i]) && str[i] != '.') {
+            return str;
+        }
+    }
+    *fps = atof(&str[at+1]);
+    return str.substr(0, at);
+}
+
+// only a single integer conversion (%d, %4d, %04d) is allowed in a sequence pattern,
+// since the pattern is passed straight to snprintf
+static bool IsSequencePattern(const std::string& str) {
+    int conversions = 0;
+    for (size_t i=0; i<str.length(); i++) {
+        if (str[i] != '%') continue;
+        i++;
+        while (i < str.length() && isdigit(str[i])) i++;
+        if (i >= str.length() || str[i] != 'd') {
+            return false;
+        }
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+static std::string FormatSequencePath(const std::string& pattern, int index) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), pattern.c_str(), index);
+    return std::string(buf);
+}
+
+bool IsAnimatedTextureSource(const char* str) {
+    float fps;
+    std::string path = SplitPlaybackRate(str, &fps);
+    return IsSequencePattern(path) || IsFileExtension(path.c_str(), ".gif");
+}
+
+AnimatedTexture::AnimatedTexture(std::string source) : source(source) {
+    path = SplitPlaybackRate(source, &fps);
+    is_gif = !IsSequencePattern(path);
+}
+
+// count the files of the sequence, on the decoder thread since long sequences take many stat calls
+int AnimatedTexture::ProbeSequence() {
+    // sequences may be numbered from either 0 or 1
+    first_index = FileExists(FormatSequencePath(path, 0).c_str()) ? 0 : 1;
+    int count = 0;
+    while (count < MAX_SEQUENCE_FRAMES && FileExists(FormatSequencePath(path, first_index + count).c_str())) {
+        count++;
+        if (count % 1024 == 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) break;
+        }
+    }
+    return count;
+}
+
+AnimatedTexture::~AnimatedTexture() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (pbo[0] != 0) {
+        glDeleteBuffers(2, pbo);
+    }
+    if (IsImageReady(gif)) {
+        UnloadImage(gif);
+    }
+}
+
+Texture2D AnimatedTexture::Start() {
+    Texture2D tex = {0};
+    // placeholder until the first frame arrives from the decoder
+    unsigned char black[4] = {0, 0, 0, 255};
+    tex.id = rlLoadTexture(black, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1);
+    tex.width = tex.height = 1;
+    tex.mipmaps = 1;
+    tex.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    SetTextureFilter(tex, TEXTURE_FILTER_BILINEAR);
+    glGenBuffers(2, pbo);
+    worker = std::thread(&AnimatedTexture::Run, this);
+    return tex;
+}
+
+bool AnimatedTexture::NextJob(int& frame, int& slot) {
+    if (frame_count < 1) {
+        return false;
+    }
+    int window = frame_count < ANIMATED_TEXTURE_RING_SIZE ? frame_count : ANIMATED_TEXTURE_RING_SIZE;
+    for (int k=0; k<window; k++) {
+        int f = (requested_frame + k) % frame_count;
+        bool queued = false;
+        for (auto& s : slots) {
+            if (s.frame == f) {
+                queued = true;
+                break;
+            }
+        }
+        if (queued) continue;
+        // reuse a slot that is empty or has fallen behind the playback window
+        for (int i=0; i<ANIMATED_TEXTURE_RING_SIZE; i++) {
+            if (slots[i].uploading) continue;
+            int d = (slots[i].frame - requested_frame + frame_count) % frame_count;
+            if (slots[i].frame == -1 || d >= window) {
+                frame = f;
+                slot = i;
+                return true;
+            }
+        }
+        return false;
+    }
+    return false;
+}
+
+bool AnimatedTexture::Decode(int frame, std::vector<unsigned char>& pixels) {
+    if (is_gif) {
+        size_t size = (size_t)width * height * 4;
+        pixels.resize(size);
+        memcpy(pixels.data(), (unsigned char*)gif.data + size*frame, size);
+        return true;
+    }
+    Image img = LoadImage(FormatSequencePath(path, first_index + frame).c_str());
+    if (!IsImageReady(img)) {
+        return false;
+    }
+    ImageFormat(&img, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (width == 0) {
+            width = img.width;
+            height = img.height;
+        }
+    }
+    if (img.width != width || img.height != height) {
+        ImageResize(&img, width, height);
+    }
+    size_t size = (size_t)width * height * 4;
+    pixels.resize(size);
+    memcpy(pixels.data(), img.data, size);
+    UnloadImage(img);
+    return true;
+}
+
+void AnimatedTexture::Run() {
+    if (is_gif) {
+        int frames = 0;
+        Image img = LoadImageAnim(path.c_str(), &frames);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!IsImageReady(img)) {
+            TraceLog(LOG_WARNING, "Failed to load animated image %s!", path.c_str());
+            return;
+        }
+        gif = img;
+        width = img.width;
+        height = img.height;
+        frame_count = frames;
+    } else {
+        int frames = ProbeSequence();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (frames == 0 && !stopping) {
+            TraceLog(LOG_WARNING, "No frames found for image sequence %s!", path.c_str());
+            return;
+        }
+        frame_count = frames;
+    }
+    std::vector<unsigned char> pixels;
+    while (true) {
+        int frame, slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return stopping || NextJob(frame, slot); });
+            if (stopping) {
+                return;
+            }
+            slots[slot].frame = frame;
+            slots[slot].ready = false;
+        }
+        bool ok = Decode(frame, pixels);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (slots[slot].frame != frame) continue;
+        if (ok) {
+            std::swap(slots[slot].pixels, pixels);
+            slots[slot].ready = true;
+            decoded_frames++;
+        } else {
+            // leave the slot claimed so the missing frame isn't retried every pass
+            dropped_frames++;
+        }
+    }
+}
+
+void AnimatedTexture::Upload(Texture2D& tex, const std::vector<unsigned char>& pixels, int width, int height) {
+    size_t size = (size_t)width * height * 4;
+    if (pixels.size() < size) {
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, tex.id);
+    if (tex.width != width || tex.height != height) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        tex.width = width;
+        tex.height = height;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[next_pbo]);
+    // orphan the previous storage so the driver never stalls waiting on an in-flight upload
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst != nullptr) {
+        memcpy(dst, pixels.data(), size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    next_pbo ^= 1;
+}
+
+void AnimatedTexture::Update(Texture2D& tex, unsigned int frame, float time) {
+    Slot* upload = nullptr;
+    int target, w, h;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (frame_count < 1) {
+            return;
+        }
+        target = fps > 0 ? (int)(time * fps) : (int)frame;
+        target %= frame_count;
+        requested_frame = target;
+        if (target != shown_frame) {
+            for (auto& s : slots) {
+                if (s.frame == target && s.ready) {
+                    // the decoder skips the slot until the copy below is done
+                    s.uploading = true;
+                    upload = &s;
+                    break;
+                }
+            }
+            // if the frame isn't decoded yet the previous one stays up rather than stalling
+        }
+        w = width;
+        h = height;
+    }
+    if (upload != nullptr) {
+        Upload(tex, upload->pixels, w, h);
+        shown_frame = target;
+        std::lock_guard<std::mutex> lock(mutex);
+        upload->uploading = false;
+    }
+    cv.notify_one();
+}
+
+AnimatedTexture::Stats AnimatedTexture::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return {frame_count, width, height, decoded_frames, dropped_frames};
+}
+
+Texture2D LoadAnimatedTexture(const char* str) {
+    AnimatedTexture* anim = new AnimatedTexture(str);
+    Texture2D tex = anim->Start();
+    if (tex.id == 0) {
+        delete anim;
+        return tex;
+    }
+    animatedTextures[tex.id] = anim;
+    return tex;
+}
+
+AnimatedTexture* GetAnimatedTexture(const Texture2D& tex) {
+    auto it = animatedTextures.find(tex.id);
+    if (it == animatedTextures.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+void UpdateAnimatedTexture(Texture2D& tex, unsigned int frame, float time) {
+    AnimatedTexture* anim = GetAnimatedTexture(tex);
+    if (anim != nullptr) {
+        anim->Update(tex, frame, time);
+    }
+}
+
+bool UnloadAnimatedTexture(Texture2D& tex) {
+    auto it = animatedTextures.find(tex.id);
+    if (it == animatedTextures.end()) {
+        return false;
+    }
+    TraceLog(LOG_DEBUG, "Unloading animated texture ID %u", tex.id);
+    delete it->second;
+    animatedTextures.erase(it);
+    UnloadTexture(tex);
+    tex = {0};
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <raylib.h>
+
+#define ANIMATED_TEXTURE_RING_SIZE 8
+
+// Sampler source that plays back an image sequence ("frames/frame_%04d.png") or an animated gif.
+// An optional "@fps" suffix plays the source back at that rate against the shader's time,
+// otherwise it follows the shader's frame counter.
+// Frames are decoded ahead on a background thread into a bounded ring of staging buffers,
+// then uploaded to the texture on the render thread through a pair of pixel buffer objects.
+// The length of an image sequence is probed on the decoder thread too, so it is 0 until that finishes.
+class AnimatedTexture {
+    struct Slot {
+        int frame = -1;
+        bool ready = false;
+        // being copied out by Update without the lock, the decoder leaves it alone
+        bool uploading = false;
+        std::vector<unsigned char> pixels;
+    };
+    std::string path;
+    bool is_gif = false;
+    int first_index = 0;
+    Image gif = {0};
+    Slot slots[ANIMATED_TEXTURE_RING_SIZE];
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+    int requested_frame = 0;
+    bool stopping = false;
+    unsigned int pbo[2] = {0};
+    int next_pbo = 0;
+    int shown_frame = -1;
+    // written by the decoder thread, guarded by mutex
+    int frame_count = 0;
+    int width = 0, height = 0;
+    unsigned int decoded_frames = 0, dropped_frames = 0;
+
+    void Run();
+    int ProbeSequence();
+    bool NextJob(int& frame, int& slot);
+    bool Decode(int frame, std::vector<unsigned char>& pixels);
+    void Upload(Texture2D& tex, const std::vector<unsigned char>& pixels, int width, int height);
+
+    public:
+    typedef struct {
+        int frame_count;
+        int width, height;
+        unsigned int decoded_frames, dropped_frames;
+    } Stats;
+
+    std::string source;
+    float fps = 0;
+
+    AnimatedTexture(std::string source);
+    ~AnimatedTexture();
+    Texture2D Start();
+    void Update(Texture2D& tex, unsigned int frame, float time);
+    Stats GetStats();
+};
+
+bool IsAnimatedTextureSource(const char* str);
+Texture2D LoadAnimatedTexture(const char* str);
+AnimatedTexture* GetAnimatedTexture(const Texture2D& tex);
+void UpdateAnimatedTexture(Texture2D& tex, unsigned int frame, float time);
+bool UnloadAnimatedTexture(Texture2D& tex);
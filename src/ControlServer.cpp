@@ -0,0 +1,276 @@
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <raylib.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "ControlServer.hpp"
+
+namespace ControlServer {
+
+typedef struct {
+    int fd;
+    std::string in, out;
+} Client;
+
+std::string socket_path;
+std::thread server;
+std::atomic<bool> stopping(false);
+
+// requests for the render thread, and the clients still connected
+std::vector<Command> queued;
+std::set<int> connected;
+std::mutex queue_mutex;
+
+// replies for the server thread to send
+std::vector<std::pair<int, std::string>> outbox;
+std::mutex outbox_mutex;
+
+// owned by the render thread
+std::map<int, std::unique_ptr<SharedMemory>> pixels;
+
+#ifndef WIN32
+int listen_fd = -1;
+// written to wake the server thread when there are replies or it should stop
+int wake_fds[2] = {-1, -1};
+
+void Wake() {
+    char c = 0;
+    if (write(wake_fds[1], &c, 1) < 0) {
+        // the pipe is full, so the thread is being woken anyway
+    }
+}
+
+void Disconnect(std::map<int, Client>& clients, int id) {
+    close(clients[id].fd);
+    clients.erase(id);
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    connected.erase(id);
+}
+
+// queue the complete lines in the client's buffer, false if the client sent too much without a newline
+bool ReadLines(int id, Client& client) {
+    size_t start = 0;
+    std::vector<Command> commands;
+    for (size_t end = client.in.find('\n'); end != std::string::npos; end = client.in.find('\n', start)) {
+        if (end > start) {
+            nlohmann::json request = nlohmann::json::parse(client.in.begin() + start, client.in.begin() + end, nullptr, false);
+            commands.push_back({id, std::move(request)});
+        }
+        start = end + 1;
+    }
+    client.in.erase(0, start);
+    if (!commands.empty()) {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        for (auto& c : commands) {
+            queued.push_back(std::move(c));
+        }
+    }
+    return client.in.size() <= CONTROL_SERVER_MAX_LINE;
+}
+
+void Run() {
+    std::map<int, Client> clients;
+    int next_id = 1;
+    std::vector<struct pollfd> fds;
+    std::vector<int> ids;
+    char buf[65536];
+    while (!stopping) {
+        fds.clear();
+        ids.clear();
+        fds.push_back({listen_fd, POLLIN, 0});
+        fds.push_back({wake_fds[0], POLLIN, 0});
+        for (auto& c : clients) {
+            fds.push_back({c.second.fd, (short)(POLLIN | (c.second.out.empty() ? 0 : POLLOUT)), 0});
+            ids.push_back(c.first);
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            continue;
+        }
+        if (fds[1].revents & POLLIN) {
+            while (read(wake_fds[0], buf, sizeof(buf)) > 0) {}
+            std::vector<std::pair<int, std::string>> replies;
+            {
+                std::lock_guard<std::mutex> lock(outbox_mutex);
+                replies.swap(outbox);
+            }
+            for (auto& r : replies) {
+                auto it = clients.find(r.first);
+                if (it != clients.end()) {
+                    it->second.out += r.second;
+                }
+            }
+        }
+        for (size_t i=0; i<ids.size(); i++) {
+            int id = ids[i];
+            Client& client = clients[id];
+            short revents = fds[i + 2].revents;
+            bool open = true;
+            if (revents & POLLIN) {
+                ssize_t len = read(client.fd, buf, sizeof(buf));
+                if (len > 0) {
+                    client.in.append(buf, len);
+                    open = ReadLines(id, client);
+                } else {
+                    open = false;
+                }
+            } else if (revents & (POLLHUP | POLLERR)) {
+                open = false;
+            }
+            // replies that came in this round are sent on the next, when poll says the socket has room
+            if (open && (revents & POLLOUT) && !client.out.empty()) {
+                ssize_t len = send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+                if (len > 0) {
+                    client.out.erase(0, len);
+                } else {
+                    open = false;
+                }
+            }
+            if (!open) {
+                Disconnect(clients, id);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd >= 0) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                int id = next_id++;
+                clients[id] = {fd, "", ""};
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                connected.insert(id);
+            }
+        }
+    }
+    for (auto& c : clients) {
+        close(c.second.fd);
+    }
+}
+#endif
+
+bool Start(const std::string& path) {
+#ifdef WIN32
+    TraceLog(LOG_WARNING, "The control server is only available on Linux and macOS");
+    return false;
+#else
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        TraceLog(LOG_WARNING, "Control socket path %s is too long", path.c_str());
+        return false;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    // a socket left behind by a run that didn't shut down would make bind fail
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path.c_str());
+    }
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 8) != 0) {
+        TraceLog(LOG_WARNING, "Failed to listen on control socket %s", path.c_str());
+        if (listen_fd >= 0) {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+        return false;
+    }
+    fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+    if (pipe(wake_fds) != 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    for (int fd : wake_fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    socket_path = path;
+    stopping = false;
+    server = std::thread(Run);
+    TraceLog(LOG_INFO, "Listening for commands on %s", path.c_str());
+    return true;
+#endif
+}
+
+void Shutdown() {
+#ifndef WIN32
+    if (!server.joinable()) {
+        return;
+    }
+    stopping = true;
+    Wake();
+    server.join();
+    close(listen_fd);
+    close(wake_fds[0]);
+    close(wake_fds[1]);
+    listen_fd = wake_fds[0] = wake_fds[1] = -1;
+    unlink(socket_path.c_str());
+#endif
+    pixels.clear();
+    queued.clear();
+    connected.clear();
+    outbox.clear();
+}
+
+std::vector<Command> Poll() {
+    std::vector<Command> commands;
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    commands.swap(queued);
+    for (auto it = pixels.begin(); it != pixels.end();) {
+        if (connected.count(it->first) == 0) {
+            it = pixels.erase(it);
+        } else {
+            it++;
+        }
+    }
+    return commands;
+}
+
+void Reply(int client, const nlohmann::json& response) {
+#ifndef WIN32
+    std::string line = response.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + "\n";
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex);
+        outbox.emplace_back(client, std::move(line));
+    }
+    Wake();
+#endif
+}
+
+SharedMemory* Pixels(int client, size_t size) {
+#ifdef WIN32
+    return nullptr;
+#else
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (connected.count(client) == 0) {
+            return nullptr;
+        }
+    }
+    auto& shm = pixels[client];
+    if (shm == nullptr) {
+        shm = std::make_unique<SharedMemory>();
+    }
+    std::string name = SharedMemory::SegmentName("c" + std::to_string(client));
+    if (!shm->Create(name, size)) {
+        pixels.erase(client);
+        return nullptr;
+    }
+    return shm.get();
+#endif
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "SharedMemory.hpp"
+#include "nlohmann/json.hpp"
+
+// a request line longer than this closes the connection
+#define CONTROL_SERVER_MAX_LINE (1<<20)
+// most frames one render command may draw, the render thread does nothing else meanwhile
+#define CONTROL_SERVER_MAX_FRAMES 600
+
+// Lets other local programs drive the app through a Unix domain socket.
+// Clients send one json object per line and get one json object per line back, in order. The socket is
+// served by its own thread, which parses the requests and queues them for the render thread to run between
+// frames (Poll and Reply). Pixels don't go through the socket: each connection has a shared memory segment
+// the render thread reads frames straight into (Pixels), and the reply says where to find them.
+namespace ControlServer {
+    typedef struct {
+        int client;
+        // discarded when the line wasn't valid json
+        nlohmann::json request;
+    } Command;
+
+    // Listen on the socket at path, replacing a stale socket left there.
+    bool Start(const std::string& path);
+    void Shutdown();
+    // Requests that arrived since the last call, in order. Closes the shared memory of clients that left.
+    std::vector<Command> Poll();
+    void Reply(int client, const nlohmann::json& response);
+    // The client's shared memory with room for at least size bytes, nullptr if the client is gone or it
+    // couldn't be made. The contents are the client's to read until it sends its next request.
+    SharedMemory* Pixels(int client, size_t size);
+}
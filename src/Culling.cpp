@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <raylib.h>
+#include "raymath.h"
+
+#include "Culling.hpp"
+
+Frustum::Frustum(Matrix m) {
+    // rows of the column-major view-projection matrix (Gribb/Hartmann plane extraction)
+    Vector4 row0 = {m.m0, m.m4, m.m8, m.m12};
+    Vector4 row1 = {m.m1, m.m5, m.m9, m.m13};
+    Vector4 row2 = {m.m2, m.m6, m.m10, m.m14};
+    Vector4 row3 = {m.m3, m.m7, m.m11, m.m15};
+    auto add = [](Vector4 a, Vector4 b) -> Vector4 { return {a.x+b.x, a.y+b.y, a.z+b.z, a.w+b.w}; };
+    auto sub = [](Vector4 a, Vector4 b) -> Vector4 { return {a.x-b.x, a.y-b.y, a.z-b.z, a.w-b.w}; };
+    planes[0] = add(row3, row0); // left
+    planes[1] = sub(row3, row0); // right
+    planes[2] = add(row3, row1); // bottom
+    planes[3] = sub(row3, row1); // top
+    planes[4] = add(row3, row2); // near
+    planes[5] = sub(row3, row2); // far
+    for (auto& p : planes) {
+        float len = sqrtf(p.x*p.x + p.y*p.y + p.z*p.z);
+        if (len > 0) {
+            p.x /= len; p.y /= len; p.z /= len; p.w /= len;
+        }
+    }
+}
+
+CullResult Frustum::Classify(const BoundingBox& box) const {
+    CullResult result = CULL_INSIDE;
+    for (auto& p : planes) {
+        // corner furthest along the plane normal, and the one furthest against it
+        Vector3 positive = {p.x >= 0 ? box.max.x : box.min.x, p.y >= 0 ? box.max.y : box.min.y, p.z >= 0 ? box.max.z : box.min.z};
+        Vector3 negative = {p.x >= 0 ? box.min.x : box.max.x, p.y >= 0 ? box.min.y : box.max.y, p.z >= 0 ? box.min.z : box.max.z};
+        if (p.x*positive.x + p.y*positive.y + p.z*positive.z + p.w < 0) {
+            return CULL_OUTSIDE;
+        }
+        if (p.x*negative.x + p.y*negative.y + p.z*negative.z + p.w < 0) {
+            result = CULL_INTERSECTING;
+        }
+    }
+    return result;
+}
+
+static BoundingBox Union(BoundingBox a, BoundingBox b) {
+    return {Vector3Min(a.min, b.min), Vector3Max(a.max, b.max)};
+}
+
+static BoundingBox Offset(BoundingBox box, Vector3 offsetMin, Vector3 offsetMax) {
+    return {Vector3Add(box.min, offsetMin), Vector3Add(box.max, offsetMax)};
+}
+
+void MeshBVH::Build(const Model& model) {
+    boxes.clear();
+    nodes.clear();
+    order.clear();
+    for (int i=0; i<model.meshCount; i++) {
+        boxes.push_back(GetMeshBoundingBox(model.meshes[i]));
+        order.push_back(i);
+    }
+    if (model.meshCount >= BVH_MIN_MESHES) {
+        nodes.reserve(2 * model.meshCount / BVH_LEAF_SIZE + 1);
+        BuildNode(0, model.meshCount);
+    }
+}
+
+int MeshBVH::BuildNode(int first, int count) {
+    Node node;
+    node.first = first;
+    node.count = count;
+    node.left = node.right = -1;
+    node.box = boxes[order[first]];
+    BoundingBox centroids = {Vector3Scale(Vector3Add(node.box.min, node.box.max), 0.5f), Vector3Scale(Vector3Add(node.box.min, node.box.max), 0.5f)};
+    for (int i=first+1; i<first+count; i++) {
+        const BoundingBox& b = boxes[order[i]];
+        node.box = Union(node.box, b);
+        Vector3 c = Vector3Scale(Vector3Add(b.min, b.max), 0.5f);
+        centroids = {Vector3Min(centroids.min, c), Vector3Max(centroids.max, c)};
+    }
+    int index = nodes.size();
+    nodes.push_back(node);
+    if (count <= BVH_LEAF_SIZE) {
+        return index;
+    }
+    // median split along the axis the centroids spread the most on
+    Vector3 extent = Vector3Subtract(centroids.max, centroids.min);
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    auto centroid = [&](int i) -> float {
+        const BoundingBox& b = boxes[i];
+        return axis == 0 ? b.min.x + b.max.x : (axis == 1 ? b.min.y + b.max.y : b.min.z + b.max.z);
+    };
+    int half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+        [&](int a, int b) { return centroid(a) < centroid(b); });
+    int left = BuildNode(first, half);
+    int right = BuildNode(first + half, count - half);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+void MeshBVH::Cull(const Frustum& frustum, Vector3 offsetMin, Vector3 offsetMax, std::vector<int>& visible, CullStats& stats) const {
+    stats.total += boxes.size();
+    if (nodes.empty()) {
+        for (int i=0; i<(int)boxes.size(); i++) {
+            stats.boxes_tested++;
+            if (frustum.Classify(Offset(boxes[i], offsetMin, offsetMax)) != CULL_OUTSIDE) {
+                visible.push_back(i);
+            }
+        }
+        return;
+    }
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        stats.nodes_visited++;
+        stats.boxes_tested++;
+        CullResult result = frustum.Classify(Offset(node.box, offsetMin, offsetMax));
+        if (result == CULL_OUTSIDE) {
+            continue;
+        }
+        if (result == CULL_INSIDE || node.left < 0) {
+            for (int i=node.first; i<node.first+node.count; i++) {
+                if (result == CULL_INSIDE || node.count == 1) {
+                    visible.push_back(order[i]);
+                } else {
+                    stats.boxes_tested++;
+                    if (frustum.Classify(Offset(boxes[order[i]], offsetMin, offsetMax)) != CULL_OUTSIDE) {
+                        visible.push_back(order[i]);
+                    }
+                }
+            }
+            continue;
+        }
+        // median splits keep the tree balanced, so depth stays far below the stack size
+        stack[top++] = node.left;
+        stack[top++] = node.right;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include <raylib.h>
+
+// models with fewer meshes than this are culled by testing every mesh box
+#define BVH_MIN_MESHES 8
+#define BVH_LEAF_SIZE 4
+
+typedef struct {
+    int total;
+    int visible;
+    int boxes_tested;
+    int nodes_visited;
+    int triangles;
+} CullStats;
+
+typedef enum {
+    CULL_OUTSIDE = -1,
+    CULL_INTERSECTING = 0,
+    CULL_INSIDE = 1,
+} CullResult;
+
+class Frustum {
+    public:
+    // plane normals point inward, a point p is inside when dot(n, p) + d >= 0
+    Vector4 planes[6];
+    Frustum(Matrix viewProjection);
+    CullResult Classify(const BoundingBox& box) const;
+};
+
+// Per-mesh bounding boxes of a model, with a bounding volume hierarchy over them for models with many meshes.
+// Every node covers a contiguous range of the mesh order so fully visible subtrees are accepted without further tests.
+class MeshBVH {
+    struct Node {
+        BoundingBox box;
+        int left, right;
+        int first, count;
+    };
+    std::vector<Node> nodes;
+    std::vector<int> order;
+    int BuildNode(int first, int count);
+
+    public:
+    std::vector<BoundingBox> boxes;
+    void Build(const Model& model);
+    // Append the indices of meshes intersecting the frustum to visible.
+    // Boxes are grown by offsetMin/offsetMax first, which covers instances translated within that range.
+    void Cull(const Frustum& frustum, Vector3 offsetMin, Vector3 offsetMax, std::vector<int>& visible, CullStats& stats) const;
+};
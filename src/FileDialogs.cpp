@@ -1,11 +1,15 @@
 #include <algorithm>
+#include <condition_variable>
 #include <cstring>
 #include <filesystem>
 #include <locale>
+#include <map>
 #include <string>
+#include <thread>
 
 #include "../external/ocornut/imgui/imgui.h"
 #include "FileDialogs.hpp"
+#include "FileIndex.hpp"
 
 #ifdef WIN32
 #define _AMD64_ 1
@@ -45,41 +49,197 @@ bool CanNarrowString16To8(std::wstring w) {
     return true;
 }
 
+std::wstring SortKey(std::wstring name) {
+    auto& f = std::use_facet<std::ctype<wchar_t>>(std::locale());
+    for (wchar_t& c : name) {
+        c = f.tolower(c);
+    }
+    return name;
+}
+
 std::vector<std::filesystem::path> DirList(std::filesystem::path path, bool folders, bool recursive) {
-    std::vector<std::filesystem::path> found;
+    std::vector<std::pair<std::wstring, std::filesystem::path>> found;
+    std::error_code err;
+    auto add = [&](const std::filesystem::directory_entry& file) {
+        std::error_code e;
+        if (folders ? file.is_directory(e) : file.is_regular_file(e)) {
+            found.push_back(std::make_pair(SortKey(file.path().wstring()), file.path()));
+        }
+    };
     if (recursive) {
-        std::filesystem::recursive_directory_iterator iter(path);
-        for (auto file : iter) {
-            if (folders && file.is_directory()) {
-                found.push_back(file.path());
-            }
-            if (!folders && file.is_regular_file()) {
-                found.push_back(file.path());
-            }
+        std::filesystem::recursive_directory_iterator iter(path, std::filesystem::directory_options::skip_permission_denied, err);
+        for (; !err && iter != std::filesystem::recursive_directory_iterator(); iter.increment(err)) {
+            add(*iter);
         }
     } else {
-        std::filesystem::directory_iterator iter(path);
-        for (auto file : iter) {
-            if (folders && file.is_directory()) {
-                found.push_back(file.path());
+        std::filesystem::directory_iterator iter(path, std::filesystem::directory_options::skip_permission_denied, err);
+        for (; !err && iter != std::filesystem::directory_iterator(); iter.increment(err)) {
+            add(*iter);
+        }
+    }
+    std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+    std::vector<std::filesystem::path> paths;
+    paths.reserve(found.size());
+    for (auto& f : found) {
+        paths.push_back(std::move(f.second));
+    }
+    return paths;
+}
+
+#pragma region Directory scanning
+
+#define DIR_SCAN_BATCH 512
+
+std::map<std::filesystem::path, std::shared_ptr<DirListing>> dir_cache;
+// folders waiting to be scanned, the most recently requested one is at the back
+std::vector<std::filesystem::path> scan_queue;
+std::mutex scan_mutex;
+std::condition_variable scan_cv;
+std::thread scanner;
+bool scan_stopping = false;
+uint64_t scan_use_counter = 0;
+
+DirEntry MakeEntry(const std::filesystem::path& path) {
+    std::wstring name = path.filename().wstring();
+    return {path, NarrowString16To8(name), CanNarrowString16To8(name), SortKey(name)};
+}
+
+void SortEntries(std::vector<DirEntry>& entries) {
+    std::sort(entries.begin(), entries.end(), [](const DirEntry& a, const DirEntry& b) {
+        return a.sort_key < b.sort_key;
+    });
+}
+
+// a scan gives up once no dialog is showing the folder, leaving only the cache and the scanner holding it
+bool ScanAbandoned(const std::shared_ptr<DirListing>& listing) {
+    std::lock_guard<std::mutex> lock(scan_mutex);
+    return scan_stopping || listing.use_count() <= 2;
+}
+
+void Scan(const std::filesystem::path& path, const std::shared_ptr<DirListing>& shared) {
+    DirListing& listing = *shared;
+    std::error_code err;
+    auto mtime = std::filesystem::last_write_time(path, err);
+    bool complete;
+    {
+        std::lock_guard<std::mutex> lock(listing.mutex);
+        if (!err && listing.complete && listing.mtime == mtime) {
+            return;
+        }
+        complete = listing.complete;
+        if (!complete) {
+            // left over from an abandoned scan
+            listing.folders.clear();
+            listing.files.clear();
+        }
+    }
+    // a folder seen for the first time is streamed into the dialog as it is read, a changed one keeps
+    // showing the old entries until the new ones are complete
+    bool stream = !complete;
+    std::vector<DirEntry> folders, files;
+    size_t published_folders = 0, published_files = 0;
+    std::filesystem::directory_iterator iter(path, std::filesystem::directory_options::skip_permission_denied, err);
+    for (int count = 1; !err && iter != std::filesystem::directory_iterator(); iter.increment(err), count++) {
+        std::error_code e;
+        if (iter->is_directory(e)) {
+            folders.push_back(MakeEntry(iter->path()));
+        } else if (iter->is_regular_file(e)) {
+            files.push_back(MakeEntry(iter->path()));
+        }
+        if (count % DIR_SCAN_BATCH == 0) {
+            if (ScanAbandoned(shared)) {
+                return;
             }
-            if (!folders && file.is_regular_file()) {
-                found.push_back(file.path());
+            if (stream) {
+                std::lock_guard<std::mutex> lock(listing.mutex);
+                listing.folders.insert(listing.folders.end(), folders.begin() + published_folders, folders.end());
+                listing.files.insert(listing.files.end(), files.begin() + published_files, files.end());
+                published_folders = folders.size();
+                published_files = files.size();
             }
         }
     }
-    auto& f = std::use_facet<std::ctype<wchar_t>>(std::locale());
-    std::sort(found.begin(), found.end(), [&f](std::filesystem::path& a, std::filesystem::path& b) -> bool {
-        std::wstring as = a.wstring();
-        std::wstring bs = b.wstring();
-        return std::lexicographical_compare(
-            as.begin(), as.end(), bs.begin(), bs.end(), [&f](wchar_t ai, wchar_t bi) {
-                return f.tolower(ai) < f.tolower(bi);
-        });
-    });
-    return found;
+    SortEntries(folders);
+    SortEntries(files);
+    std::lock_guard<std::mutex> lock(listing.mutex);
+    listing.folders = std::move(folders);
+    listing.files = std::move(files);
+    listing.error = err ? err.message() : "";
+    listing.mtime = mtime;
+    listing.complete = true;
 }
 
+void RunScanner() {
+    std::unique_lock<std::mutex> lock(scan_mutex);
+    while (true) {
+        scan_cv.wait(lock, [] { return scan_stopping || !scan_queue.empty(); });
+        if (scan_stopping) {
+            break;
+        }
+        std::filesystem::path path = scan_queue.back();
+        scan_queue.pop_back();
+        auto it = dir_cache.find(path);
+        if (it == dir_cache.end()) {
+            continue;
+        }
+        std::shared_ptr<DirListing> listing = it->second;
+        lock.unlock();
+        Scan(path, listing);
+        listing.reset();
+        lock.lock();
+    }
+}
+
+// expects scan_mutex to be held
+void TrimDirCache() {
+    while (dir_cache.size() > DIR_CACHE_SIZE) {
+        auto oldest = dir_cache.begin();
+        for (auto it = dir_cache.begin(); it != dir_cache.end(); it++) {
+            if (it->second->last_used < oldest->second->last_used) {
+                oldest = it;
+            }
+        }
+        dir_cache.erase(oldest);
+    }
+}
+
+std::shared_ptr<DirListing> ListDirectory(std::filesystem::path path) {
+    std::shared_ptr<DirListing> listing;
+    {
+        std::lock_guard<std::mutex> lock(scan_mutex);
+        if (!scanner.joinable()) {
+            scan_stopping = false;
+            scanner = std::thread(RunScanner);
+        }
+        listing = dir_cache[path];
+        if (!listing) {
+            listing = dir_cache[path] = std::make_shared<DirListing>();
+        }
+        listing->last_used = ++scan_use_counter;
+        scan_queue.erase(std::remove(scan_queue.begin(), scan_queue.end(), path), scan_queue.end());
+        scan_queue.push_back(path);
+        TrimDirCache();
+    }
+    scan_cv.notify_one();
+    return listing;
+}
+
+void StopDirectoryScans() {
+    {
+        std::lock_guard<std::mutex> lock(scan_mutex);
+        scan_stopping = true;
+        scan_queue.clear();
+    }
+    scan_cv.notify_all();
+    if (scanner.joinable()) {
+        scanner.join();
+    }
+}
+
+#pragma endregion
+
 void AddPinnedFolder(std::filesystem::path p) {
     for (auto& f : pinned_folders) {
         if (f == p) {
@@ -95,13 +255,15 @@ std::vector<std::filesystem::path> GetPinnedFolders() {
 
 bool FileDialog::Show(std::filesystem::path& selected) {
     bool clicked = false;
-    if (needs_dirlist) {
+    double now = ImGui::GetTime();
+    if (needs_dirlist || now >= recheck_time) {
         needs_dirlist = false;
-        listed_folders.clear();
-        listed_files.clear();
-        listed_folders = DirList(path, true);
-        listed_files = DirList(path, false);
+        listing = ListDirectory(path);
+        recheck_time = now + DIR_CACHE_RECHECK_INTERVAL;
     }
+    std::lock_guard<std::mutex> lock(listing->mutex);
+    auto& listed_folders = listing->folders;
+    auto& listed_files = listing->files;
     bool is_open = true;
     ImGui::Begin(title.c_str(), &is_open);
     
@@ -124,7 +286,7 @@ bool FileDialog::Show(std::filesystem::path& selected) {
         ImGui::PushID("Pinned");
         ImGui::Text("Pinned");
         for (int i = 0; i < pinned_folders.size(); i++) {
-            ImGui::PushID(i+1+listed_folders.size()+listed_files.size());
+            ImGui::PushID(i);
             std::string str = NarrowString16To8(pinned_folders[i].wstring());
             if (ImGui::Button("Unpin")) {
                 to_remove = i;
@@ -144,49 +306,89 @@ bool FileDialog::Show(std::filesystem::path& selected) {
         ImGui::PopID();
     }
 
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    ImGui::InputTextWithHint("##search", FileIndex::IsIndexing() ? "search pinned folders (indexing...)" : "search pinned folders", search, sizeof(search));
+    if (search[0] != 0) {
+        // searching replaces the folder view until the query is cleared
+        std::vector<FileIndex::Result> results = FileIndex::Search(search, FILE_INDEX_ANY, FILE_DIALOG_SEARCH_RESULTS);
+        ImGui::Text("%d matches in %d indexed files", (int)results.size(), (int)FileIndex::Size());
+        ImGuiListClipper clipper;
+        clipper.Begin((int)results.size());
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                ImGui::PushID(i);
+                if (ImGui::Button(saveas ? "Save As" : "Open")) {
+                    selected = results[i].path;
+                    clicked = true;
+                }
+                ImGui::SameLine();
+                ImGui::TextUnformatted(results[i].path.c_str());
+                ImGui::PopID();
+            }
+        }
+        ImGui::End();
+        if (!is_open) {
+            selected.clear();
+            return true;
+        }
+        return clicked;
+    }
+
     ImGui::Text("%s", NarrowString16To8(path.wstring()).c_str());
 
     if (ImGui::Button("..")) {
         path = path.parent_path();
         needs_dirlist = true;
     }
+    if (!listing->complete) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("Scanning... %d entries", (int)(listed_folders.size() + listed_files.size()));
+    }
+    if (listing->error.size() > 0) {
+        ImGui::TextColored({1.0f, 0.4f, 0.4f, 1.0f}, "%s", listing->error.c_str());
+    }
 
     ImGui::Text("Folders");
 
-    for (int i = 0; i < listed_folders.size(); i++) {
-        auto& folderName = listed_folders[i];
-        bool can_be_loaded = CanNarrowString16To8(folderName.filename().wstring());
-        std::string str = NarrowString16To8(folderName.filename().wstring());
-        ImGui::PushID(i+1);
-        if (!can_be_loaded) {
-            ImGui::PushStyleColor(ImGuiCol_Text, {255, 0, 0, 255});
-            ImGui::PushStyleColor(ImGuiCol_Button, {60, 60, 60, 255});
-            ImGui::PushStyleColor(ImGuiCol_ButtonActive, {60, 60, 60, 255});
-            ImGui::PushStyleColor(ImGuiCol_ButtonHovered, {60, 60, 60, 255});
-        }
-        if (ImGui::Button("Pin") && can_be_loaded) {
-            AddPinnedFolder(folderName);
-        }
-        ImGui::SameLine();
-        if (ImGui::Button("Open") && can_be_loaded) {
-            path = folderName;
-            needs_dirlist = true;
-        }
-        if (folder) {
+    // only the visible rows are drawn, entries come pre-formatted from the scan
+    ImGuiListClipper clipper;
+    clipper.Begin((int)listed_folders.size());
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            auto& folderName = listed_folders[i].path;
+            bool can_be_loaded = listed_folders[i].can_be_loaded;
+            const std::string& str = listed_folders[i].label;
+            ImGui::PushID(i+1);
+            if (!can_be_loaded) {
+                ImGui::PushStyleColor(ImGuiCol_Text, {255, 0, 0, 255});
+                ImGui::PushStyleColor(ImGuiCol_Button, {60, 60, 60, 255});
+                ImGui::PushStyleColor(ImGuiCol_ButtonActive, {60, 60, 60, 255});
+                ImGui::PushStyleColor(ImGuiCol_ButtonHovered, {60, 60, 60, 255});
+            }
+            if (ImGui::Button("Pin") && can_be_loaded) {
+                AddPinnedFolder(folderName);
+            }
             ImGui::SameLine();
-            if (ImGui::Button(saveas ? "Save As" : "Select") && can_be_loaded) {
-                selected = folderName;
-                clicked = true;
+            if (ImGui::Button("Open") && can_be_loaded) {
+                path = folderName;
+                needs_dirlist = true;
+            }
+            if (folder) {
+                ImGui::SameLine();
+                if (ImGui::Button(saveas ? "Save As" : "Select") && can_be_loaded) {
+                    selected = folderName;
+                    clicked = true;
+                }
+            }
+            if (!can_be_loaded) {
+                ImGui::SameLine();
+                ImGui::Text("Has Unicode Characters");
+                ImGui::PopStyleColor(4);
             }
-        }
-        if (!can_be_loaded) {
             ImGui::SameLine();
-            ImGui::Text("Has Unicode Characters");
-            ImGui::PopStyleColor(4);
+            ImGui::TextUnformatted(str.c_str());
+            ImGui::PopID();
         }
-        ImGui::SameLine();
-        ImGui::Text("%s", str.c_str());
-        ImGui::PopID();
     }
 
     if (saveas) {
@@ -202,30 +404,33 @@ bool FileDialog::Show(std::filesystem::path& selected) {
     if (!folder) {
         ImGui::Text("Files");
 
-        for (int i = 0; i < listed_files.size(); i++) {
-            auto& file = listed_files[i];
-            bool can_be_loaded = CanNarrowString16To8(file.filename().wstring());
-            std::string str = NarrowString16To8(file.filename().wstring());
-            ImGui::PushID(i+1+listed_folders.size());
-            if (!can_be_loaded) {
-                ImGui::PushStyleColor(ImGuiCol_Text, {255, 0, 0, 255});
-                ImGui::PushStyleColor(ImGuiCol_Button, {60, 60, 60, 255});
-                ImGui::PushStyleColor(ImGuiCol_ButtonActive, {60, 60, 60, 255});
-                ImGui::PushStyleColor(ImGuiCol_ButtonHovered, {60, 60, 60, 255});
-            }
-            if (ImGui::Button(saveas ? "Save As" : "Open") && can_be_loaded) {
-                selected = file;
-                needs_dirlist = true;
-                clicked = true;
-            }
-            if (!can_be_loaded) {
+        clipper.Begin((int)listed_files.size());
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                auto& file = listed_files[i].path;
+                bool can_be_loaded = listed_files[i].can_be_loaded;
+                const std::string& str = listed_files[i].label;
+                ImGui::PushID(i+1+listed_folders.size());
+                if (!can_be_loaded) {
+                    ImGui::PushStyleColor(ImGuiCol_Text, {255, 0, 0, 255});
+                    ImGui::PushStyleColor(ImGuiCol_Button, {60, 60, 60, 255});
+                    ImGui::PushStyleColor(ImGuiCol_ButtonActive, {60, 60, 60, 255});
+                    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, {60, 60, 60, 255});
+                }
+                if (ImGui::Button(saveas ? "Save As" : "Open") && can_be_loaded) {
+                    selected = file;
+                    needs_dirlist = true;
+                    clicked = true;
+                }
+                if (!can_be_loaded) {
+                    ImGui::SameLine();
+                    ImGui::Text("Has Unicode Characters");
+                    ImGui::PopStyleColor(4);
+                }
                 ImGui::SameLine();
-                ImGui::Text("Has Unicode Characters");
-                ImGui::PopStyleColor(4);
+                ImGui::TextUnformatted(str.c_str());
+                ImGui::PopID();
             }
-            ImGui::SameLine();
-            ImGui::Text("%s", str.c_str());
-            ImGui::PopID();
         }
     }
     ImGui::End();
@@ -245,6 +450,7 @@ void FileDialogManager::show() {
                 if (!selected.empty()) {
                     p.second.second(NarrowString16To8(selected.wstring()));
                 }
+                delete p.second.first;
                 p.second.first = nullptr;
             }
         }
@@ -1,11 +1,20 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
+// number of directory listings kept around after the dialog has moved on
+#define DIR_CACHE_SIZE 64
+// how often an open dialog checks whether its folder has changed, in seconds
+#define DIR_CACHE_RECHECK_INTERVAL 2.0
+#define FILE_DIALOG_SEARCH_RESULTS 200
+
 namespace FileDialogs {
     std::string NarrowString16To8(std::wstring w);
     std::wstring ExpandString8To16(std::string s);
@@ -13,13 +22,43 @@ namespace FileDialogs {
     void AddPinnedFolder(std::filesystem::path p);
     std::vector<std::filesystem::path> GetPinnedFolders();
 
+    typedef struct {
+        std::filesystem::path path;
+        // file name as shown, and whether it survived narrowing to 8 bits
+        std::string label;
+        bool can_be_loaded;
+        // lowercased file name, computed once for sorting
+        std::wstring sort_key;
+    } DirEntry;
+
+    // Contents of one folder, filled in by the scanning thread.
+    // Entries arrive in batches in the order the file system returns them, and are sorted once the scan is
+    // complete. Lock the mutex while reading them.
+    class DirListing {
+        public:
+        std::mutex mutex;
+        std::vector<DirEntry> folders;
+        std::vector<DirEntry> files;
+        bool complete = false;
+        std::string error;
+        // the folder's modification time when it was scanned, a rescan replaces the entries in one go
+        std::filesystem::file_time_type mtime;
+        uint64_t last_used = 0;
+    };
+
+    // Get the listing of a folder, scanning it in the background if it isn't cached or has changed since.
+    // A cached listing is returned straight away and replaced once a rescan finishes.
+    std::shared_ptr<DirListing> ListDirectory(std::filesystem::path path);
+    void StopDirectoryScans();
+
     class FileDialog {
         bool needs_dirlist=true, saveas, folder;
         std::filesystem::path path;
         std::string title;
+        double recheck_time = 0;
+        char search[256] = {0};
         protected:
-        std::vector<std::filesystem::path> listed_folders;
-        std::vector<std::filesystem::path> listed_files;
+        std::shared_ptr<DirListing> listing;
         public:
         FileDialog(std::string title, std::filesystem::path path, bool saveas=false, bool folder=false) : title(title), path(path), saveas(saveas), folder(folder) {}
         FileDialog(std::string title, bool saveas=false, bool folder=false) : title(title), path(std::filesystem::current_path()), saveas(saveas), folder(folder) {}
@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <raylib.h>
+#include <imgui.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "FileDialogs.hpp"
+#include "FileIndex.hpp"
+
+namespace FileIndex {
+
+typedef struct {
+    std::string path;
+    // lowercased file name
+    std::string name;
+    // which characters the name contains, see CharMask
+    uint64_t mask;
+    int kind;
+} Entry;
+
+// the published index is laid out by field, so a search mostly streams through the masks
+typedef struct {
+    std::vector<uint64_t> masks;
+    std::vector<uint8_t> kinds;
+    // lowercased names packed back to back, entry i is names[name_offsets[i]] up to name_offsets[i+1]
+    std::string names;
+    std::vector<uint32_t> name_offsets;
+    std::vector<std::string> paths;
+} Snapshot;
+
+// published index, replaced as a whole by the indexer
+std::shared_ptr<const Snapshot> snapshot;
+std::mutex snapshot_mutex;
+
+// owned by the indexer thread, keyed by path so a removed folder is a contiguous range
+std::map<std::string, Entry> files;
+bool files_dirty = false;
+
+std::vector<std::filesystem::path> roots;
+bool roots_changed = false;
+std::mutex roots_mutex;
+std::thread indexer;
+std::atomic<bool> stopping(false);
+std::atomic<bool> indexing(false);
+
+#ifdef __linux__
+int inotify_fd = -1;
+std::map<int, std::string> watches;
+bool watches_exhausted = false;
+#endif
+
+double Now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string PathString(const std::filesystem::path& p) {
+#ifdef WIN32
+    return FileDialogs::NarrowString16To8(p.wstring());
+#else
+    return p.string();
+#endif
+}
+
+uint64_t CharMask(char c) {
+    if (c >= 'a' && c <= 'z') return 1ull << (c - 'a');
+    if (c >= '0' && c <= '9') return 1ull << (26 + c - '0');
+    if (c == '_') return 1ull << 36;
+    if (c == '-') return 1ull << 37;
+    if (c == '.') return 1ull << 38;
+    if (c == ' ') return 0;
+    return 1ull << 39;
+}
+
+int Kind(const std::string& name) {
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos) return FILE_INDEX_OTHER;
+    std::string ext = name.substr(dot + 1);
+    static const char* shaders[] = {"fs", "vs", "glsl", "frag", "vert", "hlsl"};
+    static const char* images[] = {"png", "jpg", "jpeg", "bmp", "tga", "gif", "hdr", "psd", "pic", "qoi", "dds", "pkm", "ktx", "astc"};
+    static const char* models[] = {"obj", "iqm", "gltf", "glb", "vox", "m3d"};
+    for (auto e : shaders) if (ext == e) return FILE_INDEX_SHADER;
+    for (auto e : images) if (ext == e) return FILE_INDEX_IMAGE;
+    for (auto e : models) if (ext == e) return FILE_INDEX_MODEL;
+    return FILE_INDEX_OTHER;
+}
+
+void AddFile(const std::filesystem::path& p) {
+    Entry e;
+    e.path = PathString(p);
+    e.name = PathString(p.filename());
+    std::transform(e.name.begin(), e.name.end(), e.name.begin(), [](unsigned char c) { return tolower(c); });
+    e.mask = 0;
+    for (char c : e.name) e.mask |= CharMask(c);
+    e.kind = Kind(e.name);
+    files[e.path] = std::move(e);
+    files_dirty = true;
+}
+
+// removes path itself and everything below it
+void RemovePath(const std::string& path) {
+    files_dirty |= files.erase(path) > 0;
+    std::string prefix = path + (char)std::filesystem::path::preferred_separator;
+    auto it = files.lower_bound(prefix);
+    while (it != files.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+        it = files.erase(it);
+        files_dirty = true;
+    }
+}
+
+void Publish() {
+    auto s = std::make_shared<Snapshot>();
+    s->masks.reserve(files.size());
+    s->kinds.reserve(files.size());
+    s->name_offsets.reserve(files.size() + 1);
+    s->paths.reserve(files.size());
+    for (auto& f : files) {
+        s->masks.push_back(f.second.mask);
+        s->kinds.push_back(f.second.kind);
+        s->name_offsets.push_back(s->names.size());
+        s->names += f.second.name;
+        s->paths.push_back(f.second.path);
+    }
+    s->name_offsets.push_back(s->names.size());
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    snapshot = s;
+    files_dirty = false;
+}
+
+void Watch(const std::filesystem::path& dir) {
+#ifdef __linux__
+    if (inotify_fd < 0 || watches_exhausted) {
+        return;
+    }
+    std::string d = PathString(dir);
+    int wd = inotify_add_watch(inotify_fd, d.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR);
+    if (wd < 0) {
+        if (errno == ENOSPC) {
+            TraceLog(LOG_WARNING, "Out of inotify watches, the file index will be refreshed every %.0f seconds instead", FILE_INDEX_RESCAN_INTERVAL);
+            watches_exhausted = true;
+        }
+        return;
+    }
+    watches[wd] = d;
+#endif
+}
+
+void Unwatch(const std::string& dir) {
+#ifdef __linux__
+    std::string prefix = dir + "/";
+    for (auto it = watches.begin(); it != watches.end();) {
+        if (it->second == dir || it->second.compare(0, prefix.size(), prefix) == 0) {
+            inotify_rm_watch(inotify_fd, it->first);
+            it = watches.erase(it);
+        } else {
+            it++;
+        }
+    }
+#endif
+}
+
+// add everything under dir, publishing every so often so large trees become searchable while they're walked
+void Walk(const std::filesystem::path& dir, double& last_publish) {
+    std::error_code err;
+    Watch(dir);
+    std::filesystem::recursive_directory_iterator iter(dir, std::filesystem::directory_options::skip_permission_denied, err);
+    for (; !err && iter != std::filesystem::recursive_directory_iterator(); iter.increment(err)) {
+        if (stopping) {
+            return;
+        }
+        std::error_code e;
+        if (iter->is_directory(e)) {
+            Watch(iter->path());
+        } else if (iter->is_regular_file(e)) {
+            AddFile(iter->path());
+        }
+        if (Now() - last_publish > 0.5) {
+            Publish();
+            last_publish = Now();
+        }
+    }
+}
+
+void Rebuild(const std::vector<std::filesystem::path>& dirs) {
+    indexing = true;
+    double start = Now();
+    double last_publish = start;
+#ifdef __linux__
+    for (auto& w : watches) {
+        inotify_rm_watch(inotify_fd, w.first);
+    }
+    watches.clear();
+    watches_exhausted = false;
+#endif
+    files.clear();
+    for (auto& d : dirs) {
+        Walk(d, last_publish);
+    }
+    Publish();
+    indexing = false;
+    TraceLog(LOG_DEBUG, "Indexed %d files in %d pinned folders in %.2fs", (int)files.size(), (int)dirs.size(), Now() - start);
+}
+
+#ifdef __linux__
+// returns false when the events can't be trusted and the index has to be rebuilt
+bool ReadEvents() {
+    alignas(struct inotify_event) char buf[16384];
+    while (true) {
+        ssize_t len = read(inotify_fd, buf, sizeof(buf));
+        if (len <= 0) {
+            return true;
+        }
+        for (char* p = buf; p < buf + len;) {
+            struct inotify_event* ev = (struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                return false;
+            }
+            auto w = watches.find(ev->wd);
+            if (w == watches.end()) {
+                continue;
+            }
+            if (ev->mask & IN_IGNORED) {
+                watches.erase(w);
+                continue;
+            }
+            if (ev->len == 0) {
+                continue;
+            }
+            std::string path = w->second + "/" + ev->name;
+            if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                if (ev->mask & IN_ISDIR) {
+                    double last_publish = Now();
+                    Walk(path, last_publish);
+                } else {
+                    AddFile(path);
+                }
+            } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                if (ev->mask & IN_ISDIR) {
+                    Unwatch(path);
+                }
+                RemovePath(path);
+            }
+        }
+    }
+}
+#endif
+
+void Run() {
+    double last_rebuild = 0;
+    double last_change = 0;
+    std::vector<std::filesystem::path> dirs;
+    bool rebuild = false;
+    while (!stopping) {
+        {
+            std::lock_guard<std::mutex> lock(roots_mutex);
+            if (roots_changed) {
+                dirs = roots;
+                roots_changed = false;
+                rebuild = true;
+            }
+        }
+        bool live = false;
+#ifdef __linux__
+        live = inotify_fd >= 0 && !watches_exhausted;
+#endif
+        if (rebuild || (!live && Now() - last_rebuild >= FILE_INDEX_RESCAN_INTERVAL)) {
+            Rebuild(dirs);
+            last_rebuild = Now();
+            rebuild = false;
+        }
+#ifdef __linux__
+        if (live) {
+            struct pollfd pfd = {inotify_fd, POLLIN, 0};
+            if (poll(&pfd, 1, 250) > 0) {
+                rebuild = !ReadEvents();
+                last_change = Now();
+            }
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        }
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+#endif
+        // bursts of events (a tool writing out a folder of frames) are published together
+        if (files_dirty && Now() - last_change > 0.2) {
+            Publish();
+        }
+    }
+}
+
+void Start() {
+    stopping = false;
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        TraceLog(LOG_WARNING, "inotify is unavailable, the file index will be refreshed every %.0f seconds", FILE_INDEX_RESCAN_INTERVAL);
+    }
+#endif
+    indexer = std::thread(Run);
+}
+
+void Shutdown() {
+    stopping = true;
+    if (indexer.joinable()) {
+        indexer.join();
+    }
+#ifdef __linux__
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    watches.clear();
+#endif
+}
+
+void SetRoots(const std::vector<std::filesystem::path>& dirs) {
+    std::lock_guard<std::mutex> lock(roots_mutex);
+    if (dirs != roots) {
+        roots = dirs;
+        roots_changed = true;
+    }
+}
+
+inline bool IsWordStart(const char* text, size_t t) {
+    if (t == 0) return true;
+    char c = text[t-1];
+    return c == '_' || c == '-' || c == '.' || c == ' ';
+}
+
+// Score a subsequence match of query in text, or return false if it isn't one.
+// Matches are greedy from the left, consecutive runs and matches at the start of a word count for more.
+inline bool Match(const std::string& query, const char* text, size_t length, int& score) {
+    score = 0;
+    size_t t = 0;
+    size_t last = std::string::npos;
+    for (char q : query) {
+        while (t < length && text[t] != q) t++;
+        if (t == length) {
+            return false;
+        }
+        score += 16;
+        if (last != std::string::npos && t == last + 1) {
+            score += 24;
+        } else if (last != std::string::npos) {
+            score -= std::min<int>(t - last - 1, 16);
+        }
+        if (IsWordStart(text, t)) {
+            score += 32;
+        }
+        last = t;
+        t++;
+    }
+    // prefer shorter names when the matches are otherwise equal
+    score -= (int)length / 8;
+    return true;
+}
+
+std::vector<Result> Search(const std::string& query, int kinds, size_t max_results) {
+    std::shared_ptr<const Snapshot> s;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex);
+        s = snapshot;
+    }
+    std::vector<Result> results;
+    if (!s || max_results == 0) {
+        return results;
+    }
+    std::string q;
+    for (unsigned char c : query) {
+        if (c != ' ') q += tolower(c);
+    }
+    uint64_t mask = 0;
+    for (char c : q) mask |= CharMask(c);
+    if (mask == 0) {
+        return results;
+    }
+    // min-heap of the best matches so far, by score
+    std::vector<std::pair<int, size_t>> best;
+    auto worse = [](const std::pair<int, size_t>& a, const std::pair<int, size_t>& b) { return a.first > b.first; };
+    const uint64_t* masks = s->masks.data();
+    const uint8_t* entry_kinds = s->kinds.data();
+    const uint32_t* offsets = s->name_offsets.data();
+    const char* names = s->names.data();
+    // no match can score more than every character starting a word and continuing a run
+    const int best_possible = 72 * (int)q.size() - 24;
+    for (size_t i=0; i<s->masks.size(); i++) {
+        // most entries are rejected here without looking at the name
+        if ((masks[i] & mask) != mask || (entry_kinds[i] & kinds) == 0) {
+            continue;
+        }
+        uint32_t length = offsets[i+1] - offsets[i];
+        if (best.size() == max_results && best_possible - (int)length / 8 <= best.front().first) {
+            continue;
+        }
+        int score;
+        if (!Match(q, names + offsets[i], length, score)) {
+            continue;
+        }
+        if (best.size() < max_results) {
+            best.push_back(std::make_pair(score, i));
+            std::push_heap(best.begin(), best.end(), worse);
+        } else if (score > best.front().first) {
+            std::pop_heap(best.begin(), best.end(), worse);
+            best.back() = std::make_pair(score, i);
+            std::push_heap(best.begin(), best.end(), worse);
+        }
+    }
+    std::sort_heap(best.begin(), best.end(), worse);
+    for (auto& b : best) {
+        results.push_back({s->paths[b.second], b.first});
+    }
+    return results;
+}
+
+size_t Size() {
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    return snapshot ? snapshot->masks.size() : 0;
+}
+
+bool IsIndexing() {
+    return indexing;
+}
+
+bool DrawSuggestions(char* buf, size_t size, int kinds) {
+    // the list stays up while the field is edited or the list is hovered, so a click on it isn't lost
+    // when the field gives up focus
+    static ImGuiID shown_for = 0;
+    static bool list_hovered = false;
+    ImGuiID id = ImGui::GetItemID();
+    if (ImGui::IsItemActive()) {
+        shown_for = id;
+    } else if (shown_for == id && !list_hovered) {
+        shown_for = 0;
+    }
+    if (shown_for != id || buf[0] == 0) {
+        return false;
+    }
+    std::vector<Result> results = Search(buf, kinds, FILE_INDEX_SUGGESTIONS);
+    if (results.empty()) {
+        list_hovered = false;
+        return false;
+    }
+    bool picked = false;
+    float height = results.size() * ImGui::GetTextLineHeightWithSpacing() + ImGui::GetStyle().FramePadding.y * 2;
+    if (ImGui::BeginListBox("##suggestions", ImVec2(-FLT_MIN, height))) {
+        for (auto& r : results) {
+            if (ImGui::Selectable(r.path.c_str())) {
+                strncpy(buf, r.path.c_str(), size - 1);
+                buf[size - 1] = 0;
+                picked = true;
+            }
+        }
+        ImGui::EndListBox();
+    }
+    list_hovered = ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenBlockedByActiveItem);
+    if (picked) {
+        shown_for = 0;
+        list_hovered = false;
+    }
+    return picked;
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#define FILE_INDEX_SHADER 1
+#define FILE_INDEX_IMAGE 2
+#define FILE_INDEX_MODEL 4
+#define FILE_INDEX_OTHER 8
+#define FILE_INDEX_ANY 15
+// rows in the suggestion list under a path field
+#define FILE_INDEX_SUGGESTIONS 8
+// without inotify (or once it runs out of watches) the folders are walked again this often, in seconds
+#define FILE_INDEX_RESCAN_INTERVAL 30.0
+
+// Index of every file under the pinned folders, for fuzzy search by file name.
+// A background thread walks the folders when they change and keeps the index up to date from inotify
+// events on Linux. Searches run against an immutable snapshot, so they never wait on the indexer.
+namespace FileIndex {
+    typedef struct {
+        std::string path;
+        int score;
+    } Result;
+
+    void Start();
+    void Shutdown();
+    // Index these folders, does nothing if they are the ones already indexed.
+    void SetRoots(const std::vector<std::filesystem::path>& roots);
+    // Best matches for query among files of the given kinds (FILE_INDEX_*), best first.
+    std::vector<Result> Search(const std::string& query, int kinds, size_t max_results);
+    size_t Size();
+    bool IsIndexing();
+    // Draw a list of matches under the text field that was just submitted, while it is being edited.
+    // Returns true when one was picked and copied into buf.
+    bool DrawSuggestions(char* buf, size_t size, int kinds);
+}
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <raylib.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "FileWatcher.hpp"
+
+namespace FileWatcher {
+
+std::vector<std::string> files;
+bool files_changed = false;
+std::mutex files_mutex;
+
+// settled changes waiting for Poll
+std::vector<std::string> changed;
+std::mutex changed_mutex;
+
+std::thread watcher;
+std::atomic<bool> stopping(false);
+
+// owned by the watcher thread
+// time of the latest change to each path, it is reported once that is FILE_WATCHER_DEBOUNCE ago
+std::map<std::string, double> pending;
+std::map<std::string, std::filesystem::file_time_type> mtimes;
+
+#ifdef __linux__
+typedef struct {
+    // watched paths in the folder by file name, several spellings of a path can end up at one file
+    std::map<std::string, std::vector<std::string>> names;
+} Folder;
+
+int inotify_fd = -1;
+std::map<int, Folder> folders;
+#endif
+
+double Now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::filesystem::file_time_type ModTime(const std::string& path) {
+    std::error_code err;
+    auto time = std::filesystem::last_write_time(path, err);
+    return err ? std::filesystem::file_time_type::min() : time;
+}
+
+// watch the folders holding paths, polled gets the paths that can't be watched that way
+void Rewatch(const std::vector<std::string>& paths, std::vector<std::string>& polled) {
+    polled.clear();
+#ifdef __linux__
+    std::map<int, Folder> watching;
+    for (auto& path : paths) {
+        std::error_code err;
+        std::filesystem::path p = std::filesystem::absolute(path, err).lexically_normal();
+        int wd = -1;
+        if (inotify_fd >= 0 && !err && p.has_filename()) {
+            // watching the folder rather than the file sees saves that rename a new file over the old one,
+            // asking again for a folder that is already watched returns the same descriptor
+            std::string dir = p.parent_path().string();
+            wd = inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+            if (wd >= 0) {
+                watching[wd].names[p.filename().string()].push_back(path);
+            }
+        }
+        if (wd < 0) {
+            polled.push_back(path);
+        }
+    }
+    for (auto& f : folders) {
+        if (watching.count(f.first) == 0) {
+            inotify_rm_watch(inotify_fd, f.first);
+        }
+    }
+    folders = std::move(watching);
+#else
+    polled = paths;
+#endif
+    std::map<std::string, std::filesystem::file_time_type> times;
+    for (auto& path : paths) {
+        auto it = mtimes.find(path);
+        times[path] = it != mtimes.end() ? it->second : ModTime(path);
+    }
+    mtimes = std::move(times);
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (mtimes.count(it->first) == 0) {
+            it = pending.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void Check(const std::vector<std::string>& paths) {
+    for (auto& path : paths) {
+        auto time = ModTime(path);
+        auto& last = mtimes[path];
+        if (time != last) {
+            last = time;
+            pending[path] = Now();
+        }
+    }
+}
+
+#ifdef __linux__
+// returns false when events were dropped and the files have to be checked instead
+bool ReadEvents() {
+    alignas(struct inotify_event) char buf[16384];
+    bool complete = true;
+    while (true) {
+        ssize_t len = read(inotify_fd, buf, sizeof(buf));
+        if (len <= 0) {
+            return complete;
+        }
+        for (char* p = buf; p < buf + len;) {
+            struct inotify_event* ev = (struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                complete = false;
+                continue;
+            }
+            auto f = folders.find(ev->wd);
+            if (f == folders.end() || ev->len == 0) {
+                continue;
+            }
+            auto n = f->second.names.find(ev->name);
+            if (n == f->second.names.end()) {
+                continue;
+            }
+            for (auto& path : n->second) {
+                pending[path] = Now();
+            }
+        }
+    }
+}
+#endif
+
+void Run() {
+    std::vector<std::string> paths, polled;
+    double last_check = 0;
+    while (!stopping) {
+        bool rewatch = false;
+        {
+            std::lock_guard<std::mutex> lock(files_mutex);
+            if (files_changed) {
+                paths = files;
+                files_changed = false;
+                rewatch = true;
+            }
+        }
+        if (rewatch) {
+            Rewatch(paths, polled);
+        }
+#ifdef __linux__
+        if (inotify_fd >= 0) {
+            struct pollfd pfd = {inotify_fd, POLLIN, 0};
+            if (poll(&pfd, 1, 50) > 0 && !ReadEvents()) {
+                Check(paths);
+            }
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+#endif
+        if (!polled.empty() && Now() - last_check >= FILE_WATCHER_POLL_INTERVAL) {
+            Check(polled);
+            last_check = Now();
+        }
+        std::vector<std::string> settled;
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (Now() - it->second >= FILE_WATCHER_DEBOUNCE) {
+                mtimes[it->first] = ModTime(it->first);
+                settled.push_back(it->first);
+                it = pending.erase(it);
+            } else {
+                it++;
+            }
+        }
+        if (!settled.empty()) {
+            std::lock_guard<std::mutex> lock(changed_mutex);
+            for (auto& path : settled) {
+                if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+                    changed.push_back(path);
+                }
+            }
+        }
+    }
+}
+
+void Start() {
+    stopping = false;
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        TraceLog(LOG_WARNING, "inotify is unavailable, watched files will be checked for changes every %.0f seconds", FILE_WATCHER_POLL_INTERVAL);
+    }
+#endif
+    watcher = std::thread(Run);
+}
+
+void Shutdown() {
+    stopping = true;
+    if (watcher.joinable()) {
+        watcher.join();
+    }
+#ifdef __linux__
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    folders.clear();
+#endif
+    pending.clear();
+    mtimes.clear();
+}
+
+void SetFiles(std::vector<std::string> paths) {
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    std::lock_guard<std::mutex> lock(files_mutex);
+    if (paths != files) {
+        files = std::move(paths);
+        files_changed = true;
+    }
+}
+
+std::vector<std::string> Poll() {
+    std::vector<std::string> result;
+    std::lock_guard<std::mutex> lock(changed_mutex);
+    result.swap(changed);
+    return result;
+}
+
+}
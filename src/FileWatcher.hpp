@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// a file is reported once it has been left alone this long, in seconds, so a burst of writes is one change
+#define FILE_WATCHER_DEBOUNCE 0.2
+// without inotify the watched files are checked for a new modification time this often, in seconds
+#define FILE_WATCHER_POLL_INTERVAL 1.0
+
+// Notices when files in use (shaders, sampler images, models) are changed on disk by other programs.
+// On Linux the folders holding the files are watched with inotify, so saves that replace the file by
+// renaming a temporary over it are seen too. Elsewhere the modification times are polled.
+namespace FileWatcher {
+    void Start();
+    void Shutdown();
+    // Watch exactly these paths, does nothing if they are the ones already watched.
+    void SetFiles(std::vector<std::string> paths);
+    // Watched paths that changed since the last call, each reported once however many times it was written.
+    // The paths are spelled the way they were passed to SetFiles.
+    std::vector<std::string> Poll();
+}
@@ -0,0 +1,34 @@
+#include <cfloat>
+#include <cmath>
+
+#include "FrameClock.hpp"
+
+int FrameClock::Advance(double now) {
+    if (rate <= 0) {
+        return 0;
+    }
+    double interval = 1.0 / rate;
+    if (next < 0) {
+        next = now;
+    }
+    if (now < next) {
+        return 0;
+    }
+    double behind = floor((now - next) / interval) + 1;
+    int due = behind > FRAME_CLOCK_MAX_CATCH_UP ? FRAME_CLOCK_MAX_CATCH_UP : (int)behind;
+    if (behind > due) {
+        // skip the time that won't be run, the next tick is due within one interval
+        dropped += (uint64_t)(behind - due);
+        next += (behind - due) * interval;
+    }
+    next += due * interval;
+    ticks += due;
+    return due;
+}
+
+double FrameClock::Next() const {
+    if (rate <= 0) {
+        return DBL_MAX;
+    }
+    return next < 0 ? 0 : next;
+}
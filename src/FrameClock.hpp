@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// ticks a clock may run back to back to catch up, time it is further behind than that is skipped
+#define FRAME_CLOCK_MAX_CATCH_UP 8
+
+// Fixed timestep clock. Every tick stands for exactly 1/rate seconds, so whatever is driven by it (a shader's
+// time and dt uniforms) advances evenly however the ticks line up with the frames that run them.
+// When it falls too far behind, FRAME_CLOCK_MAX_CATCH_UP ticks run and the rest is dropped rather than
+// letting a slow frame snowball into more and more ticks per frame.
+class FrameClock {
+    double next = -1;
+
+    public:
+    // ticks per second, 0 or less to stop the clock
+    double rate;
+    uint64_t ticks = 0, dropped = 0;
+    FrameClock(double rate = 60) : rate(rate) {}
+    // Number of ticks due at now (seconds, from GetTime), the clock moves past them.
+    int Advance(double now);
+    // Time the next tick is due, a very large time when stopped.
+    double Next() const;
+    double Interval() const { return rate > 0 ? 1.0 / rate : 0.0; }
+    // Start counting again from now, ticks missed meanwhile are not run.
+    void Reset(double now) { next = now; }
+};
@@ -0,0 +1,143 @@
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+#include <raylib.h>
+#include <rlgl.h>
+#include <external/glad.h>
+
+#include "FrameRing.hpp"
+#include "MemoryTracker.hpp"
+
+// readers in other languages rely on these offsets, see the README
+static_assert(offsetof(FrameRingHeader, slot_offset) == 32 && offsetof(FrameRingHeader, latest) == 40 &&
+    offsetof(FrameRingHeader, closed) == 48, "FrameRingHeader layout changed");
+static_assert(sizeof(FrameRingSlot) == 16 && sizeof(std::atomic<uint64_t>) == 8, "FrameRingSlot layout changed");
+
+FrameRing::~FrameRing() {
+    Close();
+}
+
+// (re)create the segment and the pixel buffers for frames of this size
+bool FrameRing::Resize(int w, int h) {
+    Close();
+    size_t pixels = (size_t)w * h * 4;
+    // keep slots 64 byte aligned so readers can copy them out with wide loads
+    size_t stride = (sizeof(FrameRingSlot) + pixels + 63) & ~(size_t)63;
+    size_t offset = (sizeof(FrameRingHeader) + 63) & ~(size_t)63;
+    if (!shm.Create(name, offset + stride * FRAME_RING_SLOTS)) {
+        return false;
+    }
+    header = new (shm.Data()) FrameRingHeader();
+    memcpy(header->magic, FRAME_RING_MAGIC, sizeof(header->magic));
+    header->version = FRAME_RING_VERSION;
+    header->slot_count = FRAME_RING_SLOTS;
+    header->width = w;
+    header->height = h;
+    header->format = FRAME_RING_FORMAT_RGBA8;
+    header->slot_stride = stride;
+    header->slot_offset = offset;
+    header->latest.store(0);
+    header->closed.store(0);
+    for (int i=0; i<FRAME_RING_SLOTS; i++) {
+        new ((char*)shm.Data() + offset + stride * i) FrameRingSlot();
+    }
+    glGenBuffers(FRAME_RING_READBACKS, pbos);
+    for (int i=0; i<FRAME_RING_READBACKS; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, pixels, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    MemoryTracker::SetOwner(MEMORY_SHARED, (uintptr_t)&shm, owner);
+    MemoryTracker::Track(MEMORY_READBACK, pbos[0], pixels * FRAME_RING_READBACKS, owner, name);
+    width = w;
+    height = h;
+    TraceLog(LOG_INFO, "Publishing %dx%d frames to shared memory %s", w, h, name.c_str());
+    return true;
+}
+
+// copy a finished readback into its slot of the ring, slots go round by frame index
+void FrameRing::Publish(int index) {
+    uint64_t frame = frames[index];
+    FrameRingSlot* slot = (FrameRingSlot*)((char*)shm.Data() + header->slot_offset + header->slot_stride * (frame % FRAME_RING_SLOTS));
+    size_t pixels = (size_t)width * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[index]);
+    void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixels, GL_MAP_READ_BIT);
+    if (data != nullptr) {
+        uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot->frame = frame;
+        memcpy((char*)slot + sizeof(FrameRingSlot), data, pixels);
+        slot->sequence.store(sequence + 2, std::memory_order_release);
+        header->latest.store(frame + 1, std::memory_order_release);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameRing::Capture(const RenderTexture2D& target, uint64_t frame) {
+    if (target.texture.width != width || target.texture.height != height || header == nullptr) {
+        // a segment that couldn't be created is tried again once the size changes, not every frame
+        if (target.texture.width == failed_width && target.texture.height == failed_height) {
+            return;
+        }
+        if (!Resize(target.texture.width, target.texture.height)) {
+            failed_width = target.texture.width;
+            failed_height = target.texture.height;
+            return;
+        }
+        failed_width = failed_height = 0;
+    }
+    // publish what the GPU has finished, without waiting on the rest
+    while (finished < started) {
+        int index = finished % FRAME_RING_READBACKS;
+        GLenum status = glClientWaitSync((GLsync)fences[index], 0, 0);
+        // the oldest readback has to go out before a new one can use its buffer
+        if (started - finished >= FRAME_RING_READBACKS && status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync((GLsync)fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        glDeleteSync((GLsync)fences[index]);
+        fences[index] = nullptr;
+        Publish(index);
+        finished++;
+    }
+    if (started - finished >= FRAME_RING_READBACKS) {
+        // the GPU is too far behind, drop this frame rather than stall longer
+        return;
+    }
+    int index = started % FRAME_RING_READBACKS;
+    rlEnableFramebuffer(target.id);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[index]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    rlDisableFramebuffer();
+    fences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frames[index] = frame;
+    started++;
+}
+
+void FrameRing::Close() {
+    for (int i=0; i<FRAME_RING_READBACKS; i++) {
+        if (fences[i] != nullptr) {
+            glDeleteSync((GLsync)fences[i]);
+            fences[i] = nullptr;
+        }
+    }
+    if (pbos[0] != 0) {
+        MemoryTracker::Untrack(MEMORY_READBACK, pbos[0]);
+        glDeleteBuffers(FRAME_RING_READBACKS, pbos);
+        memset(pbos, 0, sizeof(pbos));
+    }
+    if (header != nullptr) {
+        header->closed.store(1, std::memory_order_release);
+        header = nullptr;
+    }
+    shm.Close();
+    started = finished = 0;
+    width = height = 0;
+}
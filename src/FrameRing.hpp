@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <raylib.h>
+
+#include "SharedMemory.hpp"
+
+// frames kept in the shared ring, a reader has this many frames of time to copy one out
+#define FRAME_RING_SLOTS 4
+// readbacks in flight, the frame drawn now is published this many frames later at most
+#define FRAME_RING_READBACKS 2
+#define FRAME_RING_MAGIC "PSTBRING"
+#define FRAME_RING_VERSION 1
+// FrameRingHeader::format
+#define FRAME_RING_FORMAT_RGBA8 1
+
+// Layout at the start of the shared memory segment. Readers map the segment, check magic and version and
+// read slot i at slot_offset + i * slot_stride. Pixels are rows bottom to top as GL keeps them.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t width, height;
+    uint32_t format;
+    uint32_t slot_stride;
+    uint64_t slot_offset;
+    // frame index of the newest published frame plus one, 0 before the first
+    std::atomic<uint64_t> latest;
+    // set when the segment is dropped (the shader was resized or stopped publishing), readers should open it again
+    std::atomic<uint32_t> closed;
+} FrameRingHeader;
+
+// Header of each slot, followed by the pixels. The sequence is odd while the slot is being written: read it,
+// copy the frame if it is even, and keep the copy if the sequence is unchanged afterwards.
+typedef struct {
+    std::atomic<uint64_t> sequence;
+    uint64_t frame;
+} FrameRingSlot;
+
+// Publishes the frames of a render texture to a shared memory ring other processes can read without ever
+// blocking the renderer. The pixels come back through pixel buffer objects, so reading a frame doesn't wait
+// for the GPU to finish drawing it: the copy is started when the frame is drawn and picked up on a later frame.
+class FrameRing {
+    SharedMemory shm;
+    FrameRingHeader* header = nullptr;
+    unsigned int pbos[FRAME_RING_READBACKS] = {0};
+    void* fences[FRAME_RING_READBACKS] = {nullptr};
+    uint64_t frames[FRAME_RING_READBACKS] = {0};
+    // readbacks started and published, the ones between are in flight
+    uint64_t started = 0, finished = 0;
+    int width = 0, height = 0;
+    // size the segment last failed to be created at
+    int failed_width = 0, failed_height = 0;
+    bool Resize(int width, int height);
+    void Publish(int index);
+
+    public:
+    std::string name;
+    // the shader publishing, for MemoryTracker
+    int owner;
+    FrameRing(const std::string& name, int owner) : name(name), owner(owner) {}
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+    ~FrameRing();
+    // Start reading back the frame in target and publish the readbacks that have completed.
+    // Call from the render thread after drawing, outside of any texture mode.
+    void Capture(const RenderTexture2D& target, uint64_t frame);
+    void Close();
+};
@@ -42,6 +42,8 @@ TextEditor::TextEditor()
 	, mColorRangeMax(0)
 	, mSelectionMode(SelectionMode::Normal)
 	, mCheckComments(true)
+	, mCommentRangeMin(0)
+	, mCommentRangeMax(0)
 	, mLastClick(-1.0f)
 	, mHandleKeyboardInputs(true)
 	, mHandleMouseInputs(true)
@@ -598,6 +600,7 @@ void TextEditor::RemoveLine(int aStart, int aEnd)
 	mBreakpoints = std::move(btmp);
 
 	mLines.erase(mLines.begin() + aStart, mLines.begin() + aEnd);
+	mLineStates.erase(mLineStates.begin() + std::min(aStart, (int)mLineStates.size()), mLineStates.begin() + std::min(aEnd, (int)mLineStates.size()));
 	assert(!mLines.empty());
 
 	mTextChanged = true;
@@ -628,6 +631,8 @@ void TextEditor::RemoveLine(int aIndex)
 	mBreakpoints = std::move(btmp);
 
 	mLines.erase(mLines.begin() + aIndex);
+	if (aIndex < (int)mLineStates.size())
+		mLineStates.erase(mLineStates.begin() + aIndex);
 	assert(!mLines.empty());
 
 	mTextChanged = true;
@@ -638,6 +643,8 @@ TextEditor::Line& TextEditor::InsertLine(int aIndex)
 	assert(!mReadOnly);
 
 	auto& result = *mLines.insert(mLines.begin() + aIndex, Line());
+	if (aIndex <= (int)mLineStates.size())
+		mLineStates.insert(mLineStates.begin() + aIndex, LineState());
 
 	ErrorMarkers etmp;
 	for (auto& i : mErrorMarkers)
@@ -1156,6 +1163,7 @@ void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
 void TextEditor::SetText(const std::string & aText)
 {
 	mLines.clear();
+	mLineStates.clear();
 	mLines.emplace_back(Line());
 	for (auto chr : aText)
 	{
@@ -1183,6 +1191,7 @@ void TextEditor::SetText(const std::string & aText)
 void TextEditor::SetTextLines(const std::vector<std::string> & aLines)
 {
 	mLines.clear();
+	mLineStates.clear();
 
 	if (aLines.empty())
 	{
@@ -2138,6 +2147,8 @@ void TextEditor::Colorize(int aFromLine, int aLines)
 	mColorRangeMax = std::max(mColorRangeMax, toLine);
 	mColorRangeMin = std::max(0, mColorRangeMin);
 	mColorRangeMax = std::max(mColorRangeMin, mColorRangeMax);
+	mCommentRangeMin = std::max(0, std::min(mCommentRangeMin, aFromLine));
+	mCommentRangeMax = std::max(mCommentRangeMax, toLine);
 	mCheckComments = true;
 }
 
@@ -2246,130 +2257,144 @@ void TextEditor::ColorizeRange(int aFromLine, int aToLine)
 	}
 }
 
-void TextEditor::ColorizeInternal()
+TextEditor::LineState TextEditor::ColorizeComments(int aLine, LineState aState)
 {
-	if (mLines.empty() || !mColorizerEnabled)
-		return;
+	auto& line = mLines[aLine];
+	auto& startStr = mLanguageDefinition.mCommentStart;
+	auto& endStr = mLanguageDefinition.mCommentEnd;
+	auto& singleStartStr = mLanguageDefinition.mSingleLineComment;
+	auto pred = [](const char& a, const Glyph& b) { return a == b.mChar; };
 
-	if (mCheckComments)
+	LineState state = aState;
+	state.mValid = true;
+	if (!state.mConcatenate)
 	{
-		auto endLine = mLines.size();
-		auto endIndex = 0;
-		auto commentStartLine = endLine;
-		auto commentStartIndex = endIndex;
-		auto withinString = false;
-		auto withinSingleLineComment = false;
-		auto withinPreproc = false;
-		auto firstChar = true;			// there is no other non-whitespace characters in the line before
-		auto concatenate = false;		// '\' on the very end of the line
-		auto currentLine = 0;
-		auto currentIndex = 0;
-		while (currentLine < endLine || currentIndex < endIndex)
-		{
-			auto& line = mLines[currentLine];
-
-			if (currentIndex == 0 && !concatenate)
-			{
-				withinSingleLineComment = false;
-				withinPreproc = false;
-				firstChar = true;
-			}
+		state.mSingleLineComment = false;
+		state.mPreprocessor = false;
+		state.mFirstChar = true;
+	}
+	state.mConcatenate = false;
 
-			concatenate = false;
+	// index of a multi-line comment opened on this line, so its own start can't also close it
+	int commentStartIndex = -1;
 
-			if (!line.empty())
-			{
-				auto& g = line[currentIndex];
-				auto c = g.mChar;
+	for (int currentIndex = 0; currentIndex < (int)line.size(); )
+	{
+		auto c = line[currentIndex].mChar;
 
-				if (c != mLanguageDefinition.mPreprocChar && !isspace(c))
-					firstChar = false;
+		if (c != mLanguageDefinition.mPreprocChar && !isspace(c))
+			state.mFirstChar = false;
 
-				if (currentIndex == (int)line.size() - 1 && line[line.size() - 1].mChar == '\\')
-					concatenate = true;
+		if (currentIndex == (int)line.size() - 1 && c == '\\')
+			state.mConcatenate = true;
 
-				bool inComment = (commentStartLine < currentLine || (commentStartLine == currentLine && commentStartIndex <= currentIndex));
+		if (state.mString)
+		{
+			line[currentIndex].mMultiLineComment = false;
+			line[currentIndex].mComment = false;
 
-				if (withinString)
+			if (c == '\"')
+			{
+				if (currentIndex + 1 < (int)line.size() && line[currentIndex + 1].mChar == '\"')
 				{
-					line[currentIndex].mMultiLineComment = inComment;
-
-					if (c == '\"')
-					{
-						if (currentIndex + 1 < (int)line.size() && line[currentIndex + 1].mChar == '\"')
-						{
-							currentIndex += 1;
-							if (currentIndex < (int)line.size())
-								line[currentIndex].mMultiLineComment = inComment;
-						}
-						else
-							withinString = false;
-					}
-					else if (c == '\\')
-					{
-						currentIndex += 1;
-						if (currentIndex < (int)line.size())
-							line[currentIndex].mMultiLineComment = inComment;
-					}
+					currentIndex += 1;
+					line[currentIndex].mMultiLineComment = false;
+					line[currentIndex].mComment = false;
 				}
 				else
+					state.mString = false;
+			}
+			else if (c == '\\')
+			{
+				currentIndex += 1;
+				if (currentIndex < (int)line.size())
 				{
-					if (firstChar && c == mLanguageDefinition.mPreprocChar)
-						withinPreproc = true;
-
-					if (c == '\"')
-					{
-						withinString = true;
-						line[currentIndex].mMultiLineComment = inComment;
-					}
-					else
-					{
-						auto pred = [](const char& a, const Glyph& b) { return a == b.mChar; };
-						auto from = line.begin() + currentIndex;
-						auto& startStr = mLanguageDefinition.mCommentStart;
-						auto& singleStartStr = mLanguageDefinition.mSingleLineComment;
-
-						if (singleStartStr.size() > 0 &&
-							currentIndex + singleStartStr.size() <= line.size() &&
-							equals(singleStartStr.begin(), singleStartStr.end(), from, from + singleStartStr.size(), pred))
-						{
-							withinSingleLineComment = true;
-						}
-						else if (!withinSingleLineComment && currentIndex + startStr.size() <= line.size() &&
-							equals(startStr.begin(), startStr.end(), from, from + startStr.size(), pred))
-						{
-							commentStartLine = currentLine;
-							commentStartIndex = currentIndex;
-						}
-
-						inComment = inComment = (commentStartLine < currentLine || (commentStartLine == currentLine && commentStartIndex <= currentIndex));
+					line[currentIndex].mMultiLineComment = false;
+					line[currentIndex].mComment = false;
+				}
+			}
+		}
+		else
+		{
+			if (state.mFirstChar && c == mLanguageDefinition.mPreprocChar)
+				state.mPreprocessor = true;
 
-						line[currentIndex].mMultiLineComment = inComment;
-						line[currentIndex].mComment = withinSingleLineComment;
+			auto from = line.begin() + currentIndex;
 
-						auto& endStr = mLanguageDefinition.mCommentEnd;
-						if (currentIndex + 1 >= (int)endStr.size() &&
-							equals(endStr.begin(), endStr.end(), from + 1 - endStr.size(), from + 1, pred))
-						{
-							commentStartIndex = endIndex;
-							commentStartLine = endLine;
-						}
-					}
+			if (!state.mSingleLineComment && !state.mMultiLineComment)
+			{
+				if (c == '\"')
+					state.mString = true;
+				else if (singleStartStr.size() > 0 &&
+					currentIndex + singleStartStr.size() <= line.size() &&
+					equals(singleStartStr.begin(), singleStartStr.end(), from, from + singleStartStr.size(), pred))
+				{
+					state.mSingleLineComment = true;
 				}
-				line[currentIndex].mPreprocessor = withinPreproc;
-				currentIndex += UTF8CharLength(c);
-				if (currentIndex >= (int)line.size())
+				else if (startStr.size() > 0 &&
+					currentIndex + startStr.size() <= line.size() &&
+					equals(startStr.begin(), startStr.end(), from, from + startStr.size(), pred))
 				{
-					currentIndex = 0;
-					++currentLine;
+					state.mMultiLineComment = true;
+					commentStartIndex = currentIndex;
 				}
 			}
-			else
+
+			line[currentIndex].mMultiLineComment = state.mMultiLineComment;
+			line[currentIndex].mComment = state.mSingleLineComment;
+
+			if (state.mMultiLineComment && endStr.size() > 0 &&
+				currentIndex + 1 >= (int)endStr.size() &&
+				(commentStartIndex < 0 || currentIndex + 1 - (int)endStr.size() >= commentStartIndex + (int)startStr.size()) &&
+				equals(endStr.begin(), endStr.end(), from + 1 - endStr.size(), from + 1, pred))
 			{
-				currentIndex = 0;
-				++currentLine;
+				state.mMultiLineComment = false;
+				commentStartIndex = -1;
 			}
 		}
+
+		line[currentIndex].mPreprocessor = state.mPreprocessor;
+		currentIndex += UTF8CharLength(c);
+	}
+
+	return state;
+}
+
+void TextEditor::ColorizeInternal()
+{
+	if (mLines.empty() || !mColorizerEnabled)
+		return;
+
+	if (mCheckComments)
+	{
+		if (mLineStates.size() != mLines.size())
+			mLineStates.assign(mLines.size(), LineState());
+
+		// resume from the state left by the last line that is still known
+		int currentLine = std::min(mCommentRangeMin, (int)mLines.size());
+		while (currentLine > 0 && !mLineStates[currentLine - 1].mValid)
+			--currentLine;
+		LineState state = currentLine > 0 ? mLineStates[currentLine - 1] : LineState();
+
+		for (; currentLine < (int)mLines.size(); ++currentLine)
+		{
+			auto end = ColorizeComments(currentLine, state);
+			bool converged = currentLine >= mCommentRangeMax - 1 && mLineStates[currentLine] == end;
+			mLineStates[currentLine] = end;
+			state = end;
+			if (converged)
+				break;
+		}
+
+		// lines after the edit whose state changed can also change between preprocessor and code, retokenize them too
+		if (currentLine >= mCommentRangeMax)
+		{
+			mColorRangeMin = std::min(mColorRangeMin, mCommentRangeMax);
+			mColorRangeMax = std::max(mColorRangeMax, std::min(currentLine + 1, (int)mLines.size()));
+		}
+
+		mCommentRangeMin = std::numeric_limits<int>::max();
+		mCommentRangeMax = 0;
 		mCheckComments = false;
 	}
 
@@ -2735,6 +2760,155 @@ static bool TokenizeCStylePunctuation(const char * in_begin, const char * in_end
 	return false;
 }
 
+static bool TokenizeCStyleComment(const char * in_begin, const char * in_end, const char *& out_begin, const char *& out_end, TextEditor::PaletteIndex & paletteIndex)
+{
+	if (in_begin + 1 >= in_end || in_begin[0] != '/')
+		return false;
+
+	if (in_begin[1] == '/')
+	{
+		// the rest of the line, its contents never need to be looked at
+		out_begin = in_begin;
+		out_end = in_end;
+		paletteIndex = TextEditor::PaletteIndex::Comment;
+		return true;
+	}
+
+	if (in_begin[1] == '*')
+	{
+		const char * p = in_begin + 2;
+
+		while (p + 1 < in_end && !(p[0] == '*' && p[1] == '/'))
+			p++;
+
+		// comments spanning several lines stop at the end of this one, ColorizeInternal tracks the rest
+		out_begin = in_begin;
+		out_end = p + 1 < in_end ? p + 2 : in_end;
+		paletteIndex = TextEditor::PaletteIndex::MultiLineComment;
+		return true;
+	}
+
+	return false;
+}
+
+static bool TokenizeCStylePreprocessor(const char * in_begin, const char * in_end, const char *& out_begin, const char *& out_end)
+{
+	const char * p = in_begin;
+
+	if (*p != '#')
+		return false;
+
+	p++;
+
+	while (p < in_end && (*p == ' ' || *p == '\t'))
+		p++;
+
+	while (p < in_end && ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || *p == '_'))
+		p++;
+
+	out_begin = in_begin;
+	out_end = p;
+	return true;
+}
+
+static bool TokenizeShaderNumber(const char * in_begin, const char * in_end, const char *& out_begin, const char *& out_end)
+{
+	const char * p = in_begin;
+
+	if (p + 1 < in_end && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+	{
+		p += 2;
+
+		while (p < in_end && ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'f') || (*p >= 'A' && *p <= 'F')))
+			p++;
+	}
+	else
+	{
+		bool hasDigits = false;
+
+		while (p < in_end && (*p >= '0' && *p <= '9'))
+		{
+			hasDigits = true;
+			p++;
+		}
+
+		// unlike C, shaders write fractions like .5 often enough that they are worth recognizing
+		if (p < in_end && *p == '.')
+		{
+			p++;
+
+			while (p < in_end && (*p >= '0' && *p <= '9'))
+			{
+				hasDigits = true;
+				p++;
+			}
+		}
+
+		if (hasDigits == false)
+			return false;
+
+		// floating point exponent, only taken if it has digits so 1e is a number followed by an identifier
+		if (p < in_end && (*p == 'e' || *p == 'E'))
+		{
+			const char * e = p + 1;
+
+			if (e < in_end && (*e == '+' || *e == '-'))
+				e++;
+
+			if (e < in_end && (*e >= '0' && *e <= '9'))
+			{
+				while (e < in_end && (*e >= '0' && *e <= '9'))
+					e++;
+
+				p = e;
+			}
+		}
+	}
+
+	// float (f, lf, h) and integer (u, l) type suffixes of both GLSL and HLSL
+	while (p < in_end && (*p == 'f' || *p == 'F' || *p == 'h' || *p == 'H' || *p == 'u' || *p == 'U' || *p == 'l' || *p == 'L'))
+		p++;
+
+	out_begin = in_begin;
+	out_end = p;
+	return true;
+}
+
+// Single pass tokenizer shared by the shading languages, always produces a token so the regex fallback is never reached.
+static bool TokenizeShaderStyle(const char * in_begin, const char * in_end, const char *& out_begin, const char *& out_end, TextEditor::PaletteIndex & paletteIndex)
+{
+	while (in_begin < in_end && (*in_begin == ' ' || *in_begin == '\t'))
+		in_begin++;
+
+	if (in_begin == in_end)
+	{
+		out_begin = in_end;
+		out_end = in_end;
+		paletteIndex = TextEditor::PaletteIndex::Default;
+	}
+	else if (TokenizeCStyleComment(in_begin, in_end, out_begin, out_end, paletteIndex))
+		;
+	else if (TokenizeCStylePreprocessor(in_begin, in_end, out_begin, out_end))
+		paletteIndex = TextEditor::PaletteIndex::Preprocessor;
+	else if (TokenizeCStyleIdentifier(in_begin, in_end, out_begin, out_end))
+		paletteIndex = TextEditor::PaletteIndex::Identifier;
+	else if (TokenizeShaderNumber(in_begin, in_end, out_begin, out_end))
+		paletteIndex = TextEditor::PaletteIndex::Number;
+	else if (TokenizeCStylePunctuation(in_begin, in_end, out_begin, out_end))
+		paletteIndex = TextEditor::PaletteIndex::Punctuation;
+	else if (TokenizeCStyleString(in_begin, in_end, out_begin, out_end))
+		paletteIndex = TextEditor::PaletteIndex::String;
+	else
+	{
+		// anything else, including the bytes of UTF-8 sequences, is skipped one byte at a time
+		out_begin = in_begin;
+		out_end = in_begin + 1;
+		paletteIndex = TextEditor::PaletteIndex::Default;
+	}
+
+	return true;
+}
+
 const TextEditor::LanguageDefinition& TextEditor::LanguageDefinition::CPlusPlus()
 {
 	static bool inited = false;
@@ -2852,15 +3026,7 @@ const TextEditor::LanguageDefinition& TextEditor::LanguageDefinition::HLSL()
 			langDef.mIdentifiers.insert(std::make_pair(std::string(k), id));
 		}
 
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[ \\t]*#[ \\t]*[a-zA-Z_]+", PaletteIndex::Preprocessor));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("L?\\\"(\\\\.|[^\\\"])*\\\"", PaletteIndex::String));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("\\'\\\\?[^\\']\\'", PaletteIndex::CharLiteral));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[+-]?([0-9]+([.][0-9]*)?|[.][0-9]+)([eE][+-]?[0-9]+)?[fF]?", PaletteIndex::Number));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[+-]?[0-9]+[Uu]?[lL]?[lL]?", PaletteIndex::Number));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("0[0-7]+[Uu]?[lL]?[lL]?", PaletteIndex::Number));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("0[xX][0-9a-fA-F]+[uU]?[lL]?[lL]?", PaletteIndex::Number));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[a-zA-Z_][a-zA-Z0-9_]*", PaletteIndex::Identifier));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[\\[\\]\\{\\}\\!\\%\\^\\&\\*\\(\\)\\-\\+\\=\\~\\|\\<\\>\\?\\/\\;\\,\\.]", PaletteIndex::Punctuation));
+		langDef.mTokenize = TokenizeShaderStyle;
 
 		langDef.mCommentStart = "/*";
 		langDef.mCommentEnd = "*/";
@@ -2883,16 +3049,33 @@ const TextEditor::LanguageDefinition& TextEditor::LanguageDefinition::GLSL()
 	if (!inited)
 	{
 		static const char* const keywords[] = {
-			"auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else", "enum", "extern", "float", "for", "goto", "if", "inline", "int", "long", "register", "restrict", "return", "short",
-			"signed", "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void", "volatile", "while", "_Alignas", "_Alignof", "_Atomic", "_Bool", "_Complex", "_Generic", "_Imaginary",
-			"_Noreturn", "_Static_assert", "_Thread_local"
+			"attribute", "break", "buffer", "case", "centroid", "coherent", "const", "continue", "default", "discard", "do", "else", "false", "flat", "for", "highp", "if", "in", "inout", "invariant",
+			"layout", "lowp", "mediump", "noperspective", "out", "patch", "precise", "precision", "readonly", "restrict", "return", "sample", "shared", "smooth", "struct", "subroutine", "switch", "true",
+			"uniform", "varying", "volatile", "while", "writeonly",
+			"void", "bool", "int", "uint", "float", "double",
+			"vec2", "vec3", "vec4", "ivec2", "ivec3", "ivec4", "uvec2", "uvec3", "uvec4", "bvec2", "bvec3", "bvec4", "dvec2", "dvec3", "dvec4",
+			"mat2", "mat3", "mat4", "mat2x2", "mat2x3", "mat2x4", "mat3x2", "mat3x3", "mat3x4", "mat4x2", "mat4x3", "mat4x4",
+			"dmat2", "dmat3", "dmat4", "dmat2x2", "dmat2x3", "dmat2x4", "dmat3x2", "dmat3x3", "dmat3x4", "dmat4x2", "dmat4x3", "dmat4x4",
+			"sampler1D", "sampler2D", "sampler3D", "samplerCube", "sampler2DRect", "sampler1DArray", "sampler2DArray", "samplerCubeArray", "samplerBuffer", "sampler2DMS", "sampler2DMSArray",
+			"sampler1DShadow", "sampler2DShadow", "samplerCubeShadow", "sampler2DRectShadow", "sampler1DArrayShadow", "sampler2DArrayShadow", "samplerCubeArrayShadow",
+			"isampler1D", "isampler2D", "isampler3D", "isamplerCube", "isampler2DArray", "isamplerBuffer", "usampler1D", "usampler2D", "usampler3D", "usamplerCube", "usampler2DArray", "usamplerBuffer",
+			"image1D", "image2D", "image3D", "imageCube", "image2DArray", "imageBuffer", "iimage2D", "uimage2D", "atomic_uint"
 		};
 		for (auto& k : keywords)
 			langDef.mKeywords.insert(k);
 
 		static const char* const identifiers[] = {
-			"abort", "abs", "acos", "asin", "atan", "atexit", "atof", "atoi", "atol", "ceil", "clock", "cosh", "ctime", "div", "exit", "fabs", "floor", "fmod", "getchar", "getenv", "isalnum", "isalpha", "isdigit", "isgraph",
-			"ispunct", "isspace", "isupper", "kbhit", "log10", "log2", "log", "memcmp", "modf", "pow", "putchar", "putenv", "puts", "rand", "remove", "rename", "sinh", "sqrt", "srand", "strcat", "strcmp", "strerror", "time", "tolower", "toupper"
+			"radians", "degrees", "sin", "cos", "tan", "asin", "acos", "atan", "sinh", "cosh", "tanh", "asinh", "acosh", "atanh", "pow", "exp", "log", "exp2", "log2", "sqrt", "inversesqrt",
+			"abs", "sign", "floor", "trunc", "round", "roundEven", "ceil", "fract", "mod", "modf", "min", "max", "clamp", "mix", "step", "smoothstep", "isnan", "isinf", "fma", "frexp", "ldexp",
+			"floatBitsToInt", "floatBitsToUint", "intBitsToFloat", "uintBitsToFloat", "packUnorm2x16", "packSnorm2x16", "packUnorm4x8", "packSnorm4x8", "unpackUnorm2x16", "unpackSnorm2x16",
+			"unpackUnorm4x8", "unpackSnorm4x8", "packHalf2x16", "unpackHalf2x16", "packDouble2x32", "unpackDouble2x32",
+			"length", "distance", "dot", "cross", "normalize", "faceforward", "reflect", "refract", "matrixCompMult", "outerProduct", "transpose", "determinant", "inverse",
+			"lessThan", "lessThanEqual", "greaterThan", "greaterThanEqual", "equal", "notEqual", "any", "all", "not",
+			"bitfieldExtract", "bitfieldInsert", "bitfieldReverse", "bitCount", "findLSB", "findMSB", "uaddCarry", "usubBorrow", "umulExtended", "imulExtended",
+			"texture", "textureSize", "textureQueryLod", "textureQueryLevels", "textureProj", "textureLod", "textureOffset", "texelFetch", "texelFetchOffset", "textureProjOffset", "textureLodOffset",
+			"textureProjLod", "textureProjLodOffset", "textureGrad", "textureGradOffset", "textureProjGrad", "textureProjGradOffset", "textureGather", "textureGatherOffset", "textureGatherOffsets",
+			"texture2D", "texture2DLod", "texture2DProj", "textureCube", "imageLoad", "imageStore", "imageSize", "dFdx", "dFdy", "fwidth", "interpolateAtCentroid", "interpolateAtSample", "interpolateAtOffset",
+			"EmitVertex", "EndPrimitive", "barrier", "memoryBarrier"
 		};
 		for (auto& k : identifiers)
 		{
@@ -2901,15 +3084,18 @@ const TextEditor::LanguageDefinition& TextEditor::LanguageDefinition::GLSL()
 			langDef.mIdentifiers.insert(std::make_pair(std::string(k), id));
 		}
 
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[ \\t]*#[ \\t]*[a-zA-Z_]+", PaletteIndex::Preprocessor));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("L?\\\"(\\\\.|[^\\\"])*\\\"", PaletteIndex::String));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("\\'\\\\?[^\\']\\'", PaletteIndex::CharLiteral));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[+-]?([0-9]+([.][0-9]*)?|[.][0-9]+)([eE][+-]?[0-9]+)?[fF]?", PaletteIndex::Number));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[+-]?[0-9]+[Uu]?[lL]?[lL]?", PaletteIndex::Number));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("0[0-7]+[Uu]?[lL]?[lL]?", PaletteIndex::Number));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("0[xX][0-9a-fA-F]+[uU]?[lL]?[lL]?", PaletteIndex::Number));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[a-zA-Z_][a-zA-Z0-9_]*", PaletteIndex::Identifier));
-		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[\\[\\]\\{\\}\\!\\%\\^\\&\\*\\(\\)\\-\\+\\=\\~\\|\\<\\>\\?\\/\\;\\,\\.]", PaletteIndex::Punctuation));
+		static const char* const variables[] = {
+			"gl_FragCoord", "gl_FrontFacing", "gl_PointCoord", "gl_FragColor", "gl_FragData", "gl_FragDepth", "gl_SampleID", "gl_SamplePosition", "gl_PrimitiveID",
+			"gl_Position", "gl_PointSize", "gl_ClipDistance", "gl_VertexID", "gl_InstanceID", "gl_Layer", "gl_ViewportIndex"
+		};
+		for (auto& k : variables)
+		{
+			Identifier id;
+			id.mDeclaration = "Built-in variable";
+			langDef.mIdentifiers.insert(std::make_pair(std::string(k), id));
+		}
+
+		langDef.mTokenize = TokenizeShaderStyle;
 
 		langDef.mCommentStart = "/*";
 		langDef.mCommentEnd = "*/";
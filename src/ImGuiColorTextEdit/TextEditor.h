@@ -312,9 +312,34 @@ private:
 
 	typedef std::vector<UndoRecord> UndoBuffer;
 
+	// Comment/string/preprocessor state of the lexer at the end of a line.
+	// Lines are rescanned from an edit only until their end state matches the one stored before it.
+	struct LineState
+	{
+		bool mValid : 1;
+		bool mMultiLineComment : 1;
+		bool mSingleLineComment : 1;
+		bool mString : 1;
+		bool mPreprocessor : 1;
+		bool mFirstChar : 1;
+		bool mConcatenate : 1;
+
+		LineState() : mValid(false), mMultiLineComment(false), mSingleLineComment(false), mString(false),
+			mPreprocessor(false), mFirstChar(true), mConcatenate(false) {}
+
+		bool operator ==(const LineState& o) const
+		{
+			return mValid == o.mValid && mMultiLineComment == o.mMultiLineComment && mSingleLineComment == o.mSingleLineComment &&
+				mString == o.mString && mPreprocessor == o.mPreprocessor && mFirstChar == o.mFirstChar && mConcatenate == o.mConcatenate;
+		}
+	};
+
+	typedef std::vector<LineState> LineStates;
+
 	void ProcessInputs();
 	void Colorize(int aFromLine = 0, int aCount = -1);
 	void ColorizeRange(int aFromLine = 0, int aToLine = 0);
+	LineState ColorizeComments(int aLine, LineState aState);
 	void ColorizeInternal();
 	float TextDistanceToLineStart(const Coordinates& aFrom) const;
 	void EnsureCursorVisible();
@@ -379,6 +404,8 @@ private:
 	RegexList mRegexList;
 
 	bool mCheckComments;
+	int mCommentRangeMin, mCommentRangeMax;
+	LineStates mLineStates;
 	Breakpoints mBreakpoints;
 	ErrorMarkers mErrorMarkers;
 	ImVec2 mCharAdvance;
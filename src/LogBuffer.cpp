@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include <raylib.h>
+#include <imgui.h>
+
+#include "LogBuffer.hpp"
+
+static double Now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LogBuffer::LogBuffer(size_t capacity, size_t arena_size) : records(capacity), arena(arena_size) {
+    start = Now();
+}
+
+void LogBuffer::Push(int level, const char* message, size_t length) {
+    double timestamp = Now() - start;
+    std::lock_guard<std::mutex> lock(mutex);
+    // a single huge message shouldn't be able to push out the whole history
+    if (length > arena.size() / 4) {
+        length = arena.size() / 4;
+    }
+    uint64_t pos = arena_head;
+    // keep every message contiguous, skipping the end of the arena if it would wrap
+    if (pos % arena.size() + length + 1 > arena.size()) {
+        pos += arena.size() - pos % arena.size();
+    }
+    memcpy(&arena[pos % arena.size()], message, length);
+    arena[pos % arena.size() + length] = 0;
+    arena_head = pos + length + 1;
+    if (head - tail == records.size()) {
+        tail++;
+    }
+    records[head % records.size()] = {level, timestamp, pos, (uint32_t)length};
+    head++;
+    // drop records whose text has just been overwritten
+    while (tail < head && arena_head > arena.size() && Get(tail).offset < arena_head - arena.size()) {
+        tail++;
+    }
+}
+
+void LogBuffer::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    tail = head;
+}
+
+void LogWindow::Refresh(LogBuffer& log) {
+    if (dirty) {
+        matches.clear();
+        first_match = 0;
+        scanned = log.First();
+        dirty = false;
+    }
+    while (first_match < matches.size() && matches[first_match] < log.First()) {
+        first_match++;
+    }
+    // compact once most of the list has been dropped, so this stays amortized constant per record
+    if (first_match > 0 && first_match >= matches.size() / 2) {
+        matches.erase(matches.begin(), matches.begin() + first_match);
+        first_match = 0;
+    }
+    if (scanned < log.First()) {
+        scanned = log.First();
+    }
+    for (; scanned < log.End(); scanned++) {
+        const LogRecord& record = log.Get(scanned);
+        const char* text = log.Text(record);
+        if (record.level >= min_level && filter.PassFilter(text, text + record.length)) {
+            matches.push_back(scanned);
+        }
+    }
+}
+
+void LogWindow::Draw(const char* title, LogBuffer& log) {
+    static const char* levels[] = {"All", "Trace", "Debug", "Info", "Warning", "Error", "Fatal"};
+    ImGui::Begin(title);
+    ImGui::SetNextItemWidth(100);
+    dirty |= ImGui::Combo("Level", &min_level, levels, IM_ARRAYSIZE(levels));
+    ImGui::SameLine();
+    dirty |= filter.Draw("Search", 200);
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        log.Clear();
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Scroll log to bottom", &scroll_to_bottom);
+    ImGui::Separator();
+
+    ImGui::BeginChild("LogLines", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
+    {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        Refresh(log);
+        ImGuiListClipper clipper;
+        clipper.Begin((int)(matches.size() - first_match));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const LogRecord& record = log.Get(matches[first_match + row]);
+                const char* text = log.Text(record);
+                char prefix[32];
+                snprintf(prefix, sizeof(prefix), "%9.3f [%s] ", record.timestamp, levels[record.level < 0 || record.level > LOG_FATAL ? 0 : record.level]);
+                bool colored = record.level >= LOG_WARNING;
+                if (colored) {
+                    ImGui::PushStyleColor(ImGuiCol_Text, record.level == LOG_WARNING ? ImVec4(1.0f, 0.8f, 0.3f, 1.0f) : ImVec4(1.0f, 0.4f, 0.4f, 1.0f));
+                }
+                ImGui::TextUnformatted(prefix);
+                ImGui::SameLine(0, 0);
+                ImGui::TextUnformatted(text, text + record.length);
+                if (colored) {
+                    ImGui::PopStyleColor();
+                }
+            }
+        }
+    }
+    if (scroll_to_bottom) {
+        ImGui::SetScrollHereY(1.0f);
+    }
+    ImGui::EndChild();
+    ImGui::End();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <imgui.h>
+
+#define LOG_BUFFER_RECORDS 8192
+#define LOG_BUFFER_ARENA (1<<20)
+
+typedef struct {
+    int level;
+    // seconds since the buffer was created
+    double timestamp;
+    // absolute position of the message in the arena, it is gone once the arena has wrapped past it
+    uint64_t offset;
+    uint32_t length;
+} LogRecord;
+
+// Fixed capacity ring of log records, messages are copied into a ring arena so logging never allocates.
+// The oldest records are dropped when either the record ring or the arena is full.
+// Records are addressed by sequence number, which keeps counting up for the lifetime of the buffer.
+class LogBuffer {
+    std::vector<LogRecord> records;
+    std::vector<char> arena;
+    uint64_t head = 0, tail = 0;
+    uint64_t arena_head = 0;
+    double start;
+
+    public:
+    std::mutex mutex;
+    LogBuffer(size_t capacity = LOG_BUFFER_RECORDS, size_t arena_size = LOG_BUFFER_ARENA);
+    void Push(int level, const char* message, size_t length);
+    void Clear();
+    // memory held by the records and the arena
+    size_t Bytes() const { return records.size() * sizeof(LogRecord) + arena.size(); }
+    // the following expect the mutex to be held
+    uint64_t First() const { return tail; }
+    uint64_t End() const { return head; }
+    const LogRecord& Get(uint64_t seq) const { return records[seq % records.size()]; }
+    const char* Text(const LogRecord& record) const { return &arena[record.offset % arena.size()]; }
+};
+
+// Debug log window over a LogBuffer, only the visible rows are drawn.
+// Rows matching the level and search filters are tracked incrementally as records arrive.
+class LogWindow {
+    std::vector<uint64_t> matches;
+    size_t first_match = 0;
+    uint64_t scanned = 0;
+    bool dirty = true;
+    int min_level = 0;
+    ImGuiTextFilter filter;
+    void Refresh(LogBuffer& log);
+
+    public:
+    bool scroll_to_bottom = true;
+    void Draw(const char* title, LogBuffer& log);
+};
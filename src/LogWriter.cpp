@@ -0,0 +1,212 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "LogWriter.hpp"
+
+namespace LogWriter {
+
+// slot of a bounded multi-producer queue (Vyukov), sequence says whose turn it is to use the slot
+struct Slot {
+    std::atomic<size_t> sequence;
+    int level;
+    uint32_t length;
+    char message[LOG_WRITER_MESSAGE];
+};
+
+const char* level_names[] = {"ALL", "TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "FATAL", "NONE"};
+
+Slot slots[LOG_WRITER_QUEUE];
+std::atomic<size_t> enqueue_pos(0);
+size_t dequeue_pos = 0;
+std::atomic<uint64_t> dropped(0);
+std::atomic<bool> stopping(false);
+// Write queues while this is set, otherwise it prints directly
+std::atomic<bool> running(false);
+std::atomic<bool> flush_requested(false);
+std::atomic<size_t> flushed_pos(0);
+std::thread writer;
+std::string path;
+FILE* file = nullptr;
+size_t file_size = 0;
+
+double Now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool Enqueue(int level, const char* message, size_t length) {
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[pos & (LOG_WRITER_QUEUE - 1)];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // full, the writer is a whole queue behind
+            return false;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    if (length > LOG_WRITER_MESSAGE) {
+        length = LOG_WRITER_MESSAGE;
+    }
+    slot->level = level;
+    slot->length = length;
+    memcpy(slot->message, message, length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+// only ever called from the writer thread
+bool Dequeue(std::string& out) {
+    Slot& slot = slots[dequeue_pos & (LOG_WRITER_QUEUE - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+        return false;
+    }
+    int level = slot.level < 0 || slot.level > 7 ? 0 : slot.level;
+    out += "[";
+    out += level_names[level];
+    out += "] ";
+    out.append(slot.message, slot.length);
+    out += "\n";
+    slot.sequence.store(dequeue_pos + LOG_WRITER_QUEUE, std::memory_order_release);
+    dequeue_pos++;
+    return true;
+}
+
+void Rotate() {
+    fclose(file);
+    for (int i=LOG_WRITER_ROTATE_KEEP-1; i>=0; i--) {
+        std::string from = i == 0 ? path : path + "." + std::to_string(i);
+        std::string to = path + "." + std::to_string(i + 1);
+        remove(to.c_str());
+        rename(from.c_str(), to.c_str());
+    }
+    file = fopen(path.c_str(), "w");
+    file_size = 0;
+}
+
+void Run() {
+    std::string batch;
+    double last_flush = Now();
+    bool unflushed = false;
+    uint64_t reported_dropped = 0;
+    while (true) {
+        bool stop = stopping.load(std::memory_order_acquire);
+        bool flush = flush_requested.load(std::memory_order_acquire);
+        while (Dequeue(batch)) {
+            // bound the batch so a burst doesn't buffer up without limit
+            if (batch.size() >= 64 * LOG_WRITER_MESSAGE) break;
+        }
+        uint64_t lost = dropped.load(std::memory_order_relaxed);
+        if (lost != reported_dropped) {
+            batch += "[WARNING] " + std::to_string(lost - reported_dropped) + " log messages dropped\n";
+            reported_dropped = lost;
+        }
+        bool wrote = batch.size() > 0;
+        if (wrote) {
+            fwrite(batch.data(), 1, batch.size(), stdout);
+            if (file != nullptr) {
+                fwrite(batch.data(), 1, batch.size(), file);
+                file_size += batch.size();
+            }
+            batch.clear();
+            unflushed = true;
+        }
+        if (unflushed && (flush || stop || Now() - last_flush >= LOG_WRITER_FLUSH_INTERVAL)) {
+            fflush(stdout);
+            if (file != nullptr) fflush(file);
+            last_flush = Now();
+            unflushed = false;
+        }
+        if (flush) {
+            flushed_pos.store(dequeue_pos, std::memory_order_release);
+            flush_requested.store(false, std::memory_order_release);
+        }
+        if (file != nullptr && file_size >= LOG_WRITER_ROTATE_SIZE) {
+            Rotate();
+        }
+        if (stop && !wrote) {
+            break;
+        }
+        if (!wrote) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+}
+
+bool Start(const char* filename) {
+    for (size_t i=0; i<LOG_WRITER_QUEUE; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueue_pos.store(0);
+    dequeue_pos = 0;
+    stopping.store(false);
+    path = filename;
+    file = fopen(filename, "w");
+    writer = std::thread(Run);
+    running.store(true, std::memory_order_release);
+    return file != nullptr;
+}
+
+void Write(int level, const char* message, size_t length) {
+    if (!running.load(std::memory_order_acquire)) {
+        int l = level < 0 || level > 7 ? 0 : level;
+        fprintf(stdout, "[%s] %.*s\n", level_names[l], (int)length, message);
+        fflush(stdout);
+        return;
+    }
+    if (!Enqueue(level, message, length)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Flush() {
+    if (!writer.joinable() || std::this_thread::get_id() == writer.get_id()) {
+        return;
+    }
+    size_t target = enqueue_pos.load(std::memory_order_acquire);
+    double deadline = Now() + 1.0;
+    while (Now() < deadline) {
+        flush_requested.store(true, std::memory_order_release);
+        if (flushed_pos.load(std::memory_order_acquire) >= target) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Shutdown() {
+    // messages queued before this are still drained, the writer only stops once a pass finds nothing
+    running.store(false, std::memory_order_release);
+    stopping.store(true, std::memory_order_release);
+    if (writer.joinable()) {
+        writer.join();
+    }
+    // a Write that saw running just before it was cleared may have queued after the writer's last pass
+    std::string rest;
+    while (Dequeue(rest)) {}
+    if (rest.size() > 0) {
+        fwrite(rest.data(), 1, rest.size(), stdout);
+        fflush(stdout);
+        if (file != nullptr) fwrite(rest.data(), 1, rest.size(), file);
+    }
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+uint64_t Dropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// must be a power of two
+#define LOG_WRITER_QUEUE 4096
+#define LOG_WRITER_MESSAGE 512
+#define LOG_WRITER_FLUSH_INTERVAL 0.5
+#define LOG_WRITER_ROTATE_SIZE (8<<20)
+// number of rotated files kept next to the log (debug.log.1 ... debug.log.N)
+#define LOG_WRITER_ROTATE_KEEP 3
+
+// Writes log messages to stdout and a log file from a dedicated thread.
+// Any thread can Write; messages go through a bounded lock-free queue and are dropped (and counted) when
+// it is full, so a logging thread never waits on I/O.
+namespace LogWriter {
+    bool Start(const char* path);
+    // Before Start and after Shutdown there is no writer thread, messages are printed to stdout right away.
+    void Write(int level, const char* message, size_t length);
+    // Wait (up to a second) until everything written so far is on disk, for use before the process dies.
+    void Flush();
+    void Shutdown();
+    uint64_t Dropped();
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <raylib.h>
+#include <imgui.h>
+
+#include "MemoryTracker.hpp"
+
+namespace MemoryTracker {
+
+typedef struct {
+    size_t bytes;
+    int owner;
+    std::string label;
+} Allocation;
+
+typedef struct {
+    size_t count, bytes, peak;
+} Usage;
+
+const char* category_names[MEMORY_CATEGORIES] = {
+    "Render targets", "Textures", "Model buffers", "Model data", "Instance buffers", "Readback buffers",
+    "GIF encoder", "Log", "Shared memory",
+};
+const bool category_gpu[MEMORY_CATEGORIES] = {
+    true, true, true, false, true, true,
+    false, false, false,
+};
+
+std::map<std::pair<int, uint64_t>, Allocation> allocations;
+Usage categories[MEMORY_CATEGORIES] = {{0}};
+// [0] CPU, [1] GPU
+Usage totals[2] = {{0}};
+size_t gpu_budget = 0;
+bool over_budget = false;
+std::mutex mutex;
+
+void Add(MemoryCategory category, const Allocation& a, int sign) {
+    Usage& c = categories[category];
+    Usage& t = totals[category_gpu[category]];
+    if (sign > 0) {
+        c.count++;
+        c.bytes += a.bytes;
+        t.count++;
+        t.bytes += a.bytes;
+    } else {
+        c.count--;
+        c.bytes -= a.bytes;
+        t.count--;
+        t.bytes -= a.bytes;
+    }
+    c.peak = std::max(c.peak, c.bytes);
+    t.peak = std::max(t.peak, t.bytes);
+}
+
+// expects the mutex to be held
+void CheckBudget() {
+    bool over = gpu_budget > 0 && totals[1].bytes > gpu_budget;
+    if (over && !over_budget) {
+        TraceLog(LOG_WARNING, "Tracked GPU memory (%.1f MB) is over the budget of %.1f MB",
+            totals[1].bytes / 1048576.0, gpu_budget / 1048576.0);
+    }
+    over_budget = over;
+}
+
+void Track(MemoryCategory category, uint64_t id, size_t bytes, int owner, const std::string& label) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto key = std::make_pair((int)category, id);
+    auto it = allocations.find(key);
+    if (it != allocations.end()) {
+        Add(category, it->second, -1);
+        it->second = {bytes, owner, label.empty() ? it->second.label : label};
+    } else {
+        it = allocations.insert({key, {bytes, owner, label}}).first;
+    }
+    Add(category, it->second, 1);
+    CheckBudget();
+}
+
+void SetOwner(MemoryCategory category, uint64_t id, int owner) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = allocations.find({(int)category, id});
+    if (it != allocations.end()) {
+        it->second.owner = owner;
+    }
+}
+
+void Untrack(MemoryCategory category, uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = allocations.find({(int)category, id});
+    if (it != allocations.end()) {
+        Add(category, it->second, -1);
+        allocations.erase(it);
+        CheckBudget();
+    }
+}
+
+const char* CategoryName(MemoryCategory category) {
+    return category >= 0 && category < MEMORY_CATEGORIES ? category_names[category] : "Unknown";
+}
+
+bool IsGPU(MemoryCategory category) {
+    return category >= 0 && category < MEMORY_CATEGORIES && category_gpu[category];
+}
+
+void SetGPUBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    gpu_budget = bytes;
+    CheckBudget();
+}
+
+size_t GetGPUBudget() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return gpu_budget;
+}
+
+nlohmann::json UsageJson(const Usage& u) {
+    return {{"count", u.count}, {"bytes", u.bytes}, {"peak", u.peak}};
+}
+
+// expects the mutex to be held
+nlohmann::json DumpLocked() {
+    nlohmann::json json = {{"cpu", UsageJson(totals[0])}, {"gpu", UsageJson(totals[1])}, {"gpu_budget", gpu_budget}};
+    nlohmann::json cats = nlohmann::json::object();
+    for (int c=0; c<MEMORY_CATEGORIES; c++) {
+        nlohmann::json j = UsageJson(categories[c]);
+        j["gpu"] = category_gpu[c];
+        cats[category_names[c]] = j;
+    }
+    json["categories"] = cats;
+    nlohmann::json list = nlohmann::json::array();
+    for (auto& a : allocations) {
+        list.push_back({{"category", category_names[a.first.first]}, {"id", a.first.second}, {"bytes", a.second.bytes},
+            {"owner", a.second.owner}, {"label", a.second.label}});
+    }
+    json["allocations"] = list;
+    return json;
+}
+
+nlohmann::json Dump() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return DumpLocked();
+}
+
+std::string FormatBytes(size_t bytes) {
+    if (bytes >= (1u << 20)) return TextFormat("%.1f MB", bytes / 1048576.0);
+    if (bytes >= (1u << 10)) return TextFormat("%.1f KB", bytes / 1024.0);
+    return TextFormat("%zu B", bytes);
+}
+
+void DrawWindow(const char* title) {
+    if (!ImGui::Begin(title)) {
+        ImGui::End();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    ImGui::Text("GPU %s (peak %s), CPU %s (peak %s)", FormatBytes(totals[1].bytes).c_str(), FormatBytes(totals[1].peak).c_str(),
+        FormatBytes(totals[0].bytes).c_str(), FormatBytes(totals[0].peak).c_str());
+    if (over_budget) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "over budget");
+    }
+    int budget_mb = gpu_budget >> 20;
+    ImGui::SetNextItemWidth(120);
+    if (ImGui::InputInt("GPU budget (MB)", &budget_mb, 64, 256) && budget_mb >= 0) {
+        gpu_budget = (size_t)budget_mb << 20;
+        CheckBudget();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Reset Peaks")) {
+        for (auto& u : categories) u.peak = u.bytes;
+        for (auto& u : totals) u.peak = u.bytes;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Copy JSON")) {
+        ImGui::SetClipboardText(DumpLocked().dump(2).c_str());
+    }
+
+    if (ImGui::BeginTable("MemoryCategories", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+        ImGui::TableSetupColumn("Category");
+        ImGui::TableSetupColumn("Where");
+        ImGui::TableSetupColumn("Count");
+        ImGui::TableSetupColumn("Size");
+        ImGui::TableSetupColumn("Peak");
+        ImGui::TableHeadersRow();
+        for (int c=0; c<MEMORY_CATEGORIES; c++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(category_names[c]);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(category_gpu[c] ? "GPU" : "CPU");
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", categories[c].count);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(FormatBytes(categories[c].bytes).c_str());
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(FormatBytes(categories[c].peak).c_str());
+        }
+        ImGui::EndTable();
+    }
+
+    // per owner breakdown
+    std::map<int, std::vector<const std::pair<const std::pair<int, uint64_t>, Allocation>*>> owners;
+    for (auto& a : allocations) {
+        owners[a.second.owner].push_back(&a);
+    }
+    for (auto& o : owners) {
+        size_t gpu = 0, cpu = 0;
+        for (auto a : o.second) {
+            (category_gpu[a->first.first] ? gpu : cpu) += a->second.bytes;
+        }
+        std::string name = o.first == MEMORY_NO_OWNER ? "Shared" : "Shader " + std::to_string(o.first);
+        if (ImGui::TreeNode(name.c_str(), "%s: GPU %s, CPU %s", name.c_str(), FormatBytes(gpu).c_str(), FormatBytes(cpu).c_str())) {
+            for (auto a : o.second) {
+                ImGui::BulletText("%s %s %s", category_names[a->first.first], FormatBytes(a->second.bytes).c_str(), a->second.label.c_str());
+            }
+            ImGui::TreePop();
+        }
+    }
+    ImGui::End();
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "nlohmann/json.hpp"
+
+typedef enum {
+    MEMORY_RENDER_TARGETS = 0,
+    MEMORY_TEXTURES,
+    MEMORY_MODEL_BUFFERS,
+    MEMORY_MODEL_DATA,
+    MEMORY_INSTANCES,
+    MEMORY_READBACK,
+    MEMORY_GIF,
+    MEMORY_LOG,
+    MEMORY_SHARED,
+    MEMORY_CATEGORIES,
+} MemoryCategory;
+
+// owner of allocations that don't belong to one shader (cached models, idle render targets, the log)
+#define MEMORY_NO_OWNER -1
+
+// Registry of the memory the app allocates, GPU and CPU, by category and owning shader.
+// Allocations are identified by category and an id unique within it (a GL object id, a shader number, a pointer).
+// Sizes are estimates from dimensions and formats, drivers may pad them. Thread safe.
+namespace MemoryTracker {
+    // Add an allocation, or update its size, owner and label if it is already tracked.
+    void Track(MemoryCategory category, uint64_t id, size_t bytes, int owner = MEMORY_NO_OWNER, const std::string& label = "");
+    // Does nothing for allocations that aren't tracked.
+    void SetOwner(MemoryCategory category, uint64_t id, int owner);
+    void Untrack(MemoryCategory category, uint64_t id);
+    const char* CategoryName(MemoryCategory category);
+    bool IsGPU(MemoryCategory category);
+    // a warning is logged when tracked GPU memory goes over this, 0 for no budget
+    void SetGPUBudget(size_t bytes);
+    size_t GetGPUBudget();
+    // Totals, high-water marks, and every allocation with its owner.
+    nlohmann::json Dump();
+    void DrawWindow(const char* title);
+}
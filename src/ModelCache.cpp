@@ -0,0 +1,564 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <raylib.h>
+#include "raymath.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// the implementation is compiled into raylib (rmodels.c)
+extern "C" {
+#include <external/tinyobj_loader_c.h>
+}
+
+#include "ModelCache.hpp"
+#include "MemoryTracker.hpp"
+
+#define MODEL_CACHE_DIR ".cache/models"
+#define MODEL_CACHE_VERSION 2
+
+namespace ModelCache {
+
+typedef enum {
+    STAGE_QUEUED = 0,
+    STAGE_PARSING,
+    STAGE_PARSED,
+    STAGE_NEEDS_SYNC_LOAD,
+    STAGE_READY,
+    STAGE_FAILED,
+} LoadStage;
+
+struct Entry {
+    int refs = 0;
+    LoadStage stage = STAGE_QUEUED;
+    Model model = {0};
+    MeshBVH bounds;
+};
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    int64_t source_size;
+    int64_t source_mtime;
+    uint32_t mesh_count;
+};
+
+struct MeshCacheMesh {
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+    uint32_t flags;
+};
+
+enum {
+    MESH_HAS_TEXCOORDS = 1,
+    MESH_HAS_TEXCOORDS2 = 2,
+    MESH_HAS_NORMALS = 4,
+    MESH_HAS_TANGENTS = 8,
+    MESH_HAS_COLORS = 16,
+    MESH_HAS_INDICES = 32,
+};
+
+struct Retired {
+    std::string path;
+    Entry* entry;
+    // set once the entry replacing it is loaded, it is freed on the next Poll
+    bool replaced;
+};
+
+std::map<std::string, Entry*> entries;
+// entries replaced by Reload, kept until every holder has had a frame to pick up the new model
+std::vector<Retired> retired;
+std::deque<std::string> queue;
+std::mutex mutex;
+std::condition_variable cv;
+std::thread worker;
+bool stopping = false;
+
+std::string CachePath(const std::string& path) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.psmc", (unsigned long long)std::hash<std::string>()(path));
+    return std::string(MODEL_CACHE_DIR) + "/" + name;
+}
+
+// vertex data of a mesh, raylib keeps a copy in RAM of what it uploads
+size_t MeshBytes(const Mesh& mesh) {
+    size_t v = mesh.vertexCount;
+    size_t bytes = v * 3 * sizeof(float);
+    if (mesh.texcoords != NULL) bytes += v * 2 * sizeof(float);
+    if (mesh.texcoords2 != NULL) bytes += v * 2 * sizeof(float);
+    if (mesh.normals != NULL) bytes += v * 3 * sizeof(float);
+    if (mesh.tangents != NULL) bytes += v * 4 * sizeof(float);
+    if (mesh.colors != NULL) bytes += v * 4;
+    if (mesh.indices != NULL) bytes += (size_t)mesh.triangleCount * 3 * sizeof(unsigned short);
+    return bytes;
+}
+
+// count an uploaded model in both its buffers and the copy kept in RAM
+void TrackModel(const std::string& path, Entry* entry) {
+    size_t bytes = 0;
+    for (int i=0; i<entry->model.meshCount; i++) {
+        bytes += MeshBytes(entry->model.meshes[i]);
+    }
+    MemoryTracker::Track(MEMORY_MODEL_BUFFERS, (uintptr_t)entry, bytes, MEMORY_NO_OWNER, path);
+    MemoryTracker::Track(MEMORY_MODEL_DATA, (uintptr_t)entry, bytes, MEMORY_NO_OWNER, path);
+}
+
+void UnloadEntryModel(Entry* entry) {
+    MemoryTracker::Untrack(MEMORY_MODEL_BUFFERS, (uintptr_t)entry);
+    MemoryTracker::Untrack(MEMORY_MODEL_DATA, (uintptr_t)entry);
+    UnloadModel(entry->model);
+}
+
+// free meshes that were never uploaded, safe to call off the render thread
+void FreeMeshes(Model& model) {
+    for (int i=0; i<model.meshCount; i++) {
+        Mesh& mesh = model.meshes[i];
+        RL_FREE(mesh.vertices);
+        RL_FREE(mesh.texcoords);
+        RL_FREE(mesh.texcoords2);
+        RL_FREE(mesh.normals);
+        RL_FREE(mesh.tangents);
+        RL_FREE(mesh.colors);
+        RL_FREE(mesh.indices);
+    }
+    RL_FREE(model.meshes);
+    model = {0};
+}
+
+// Read a cached model, validated against the size and modification time of the source file
+bool ReadMeshCache(const std::string& path, Model& model) {
+    std::string cachePath = CachePath(path);
+    int64_t sourceSize = GetFileLength(path.c_str());
+    int64_t sourceTime = GetFileModTime(path.c_str());
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+#ifdef WIN32
+    std::vector<char> contents;
+    {
+        std::ifstream fd(cachePath, std::ios::in | std::ios::binary);
+        if (!fd.is_open()) return false;
+        fd.seekg(0, std::ios::end);
+        size = fd.tellg();
+        fd.seekg(0, std::ios::beg);
+        contents.resize(size);
+        fd.read(contents.data(), size);
+    }
+    data = (const unsigned char*)contents.data();
+#else
+    int fd = open(cachePath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(MeshCacheHeader)) {
+        close(fd);
+        return false;
+    }
+    size = st.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    data = (const unsigned char*)mapped;
+#endif
+    const unsigned char* end = data + size;
+    const unsigned char* p = data;
+    bool ok = false;
+    // lengths come from the file, compared with what is left rather than added to p so they can't overflow
+    auto take = [&](void* dst, size_t len) -> bool {
+        if (len > (size_t)(end - p)) return false;
+        if (dst != nullptr) memcpy(dst, p, len);
+        p += len;
+        return true;
+    };
+    auto takeArray = [&](void** dst, size_t len) -> bool {
+        // checked before allocating, a corrupt count would otherwise ask for gigabytes
+        if (len > (size_t)(end - p)) return false;
+        *dst = RL_MALLOC(len);
+        return *dst != nullptr && take(*dst, len);
+    };
+    MeshCacheHeader header;
+    if (take(&header, sizeof(header)) && !memcmp(header.magic, "PSMC", 4) && header.version == MODEL_CACHE_VERSION &&
+        header.source_size == sourceSize && header.source_mtime == sourceTime && header.mesh_count > 0 &&
+        header.mesh_count <= (size_t)(end - p) / sizeof(MeshCacheMesh)) {
+        model.meshCount = header.mesh_count;
+        model.meshes = (Mesh*)RL_CALLOC(model.meshCount, sizeof(Mesh));
+        ok = model.meshes != nullptr;
+        if (!ok) model.meshCount = 0;
+        for (int i=0; ok && i<model.meshCount; i++) {
+            MeshCacheMesh info;
+            Mesh& mesh = model.meshes[i];
+            ok = take(&info, sizeof(info));
+            if (!ok) break;
+            size_t vc = info.vertex_count;
+            mesh.vertexCount = info.vertex_count;
+            mesh.triangleCount = info.triangle_count;
+            ok = takeArray((void**)&mesh.vertices, vc*3*sizeof(float));
+            if (ok && (info.flags & MESH_HAS_TEXCOORDS)) ok = takeArray((void**)&mesh.texcoords, vc*2*sizeof(float));
+            if (ok && (info.flags & MESH_HAS_TEXCOORDS2)) ok = takeArray((void**)&mesh.texcoords2, vc*2*sizeof(float));
+            if (ok && (info.flags & MESH_HAS_NORMALS)) ok = takeArray((void**)&mesh.normals, vc*3*sizeof(float));
+            if (ok && (info.flags & MESH_HAS_TANGENTS)) ok = takeArray((void**)&mesh.tangents, vc*4*sizeof(float));
+            if (ok && (info.flags & MESH_HAS_COLORS)) ok = takeArray((void**)&mesh.colors, vc*4);
+            if (ok && (info.flags & MESH_HAS_INDICES)) ok = takeArray((void**)&mesh.indices, info.triangle_count*3*sizeof(unsigned short));
+        }
+        if (!ok) {
+            TraceLog(LOG_WARNING, "Model cache %s for %s is corrupt or truncated, ignoring it", cachePath.c_str(), path.c_str());
+            FreeMeshes(model);
+        }
+    }
+#ifndef WIN32
+    munmap((void*)data, size);
+#endif
+    return ok;
+}
+
+void WriteMeshCache(const std::string& path, const Model& model) {
+    for (int i=0; i<model.meshCount; i++) {
+        // skinned meshes carry data this format doesn't store
+        if (model.meshes[i].boneWeights != nullptr) return;
+    }
+    std::string cachePath = CachePath(path);
+    std::string tmpPath = cachePath + ".tmp";
+    std::error_code err;
+    std::filesystem::create_directories(MODEL_CACHE_DIR, err);
+    std::ofstream fd(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!fd.is_open()) {
+        TraceLog(LOG_WARNING, "Failed to write model cache %s", cachePath.c_str());
+        return;
+    }
+    MeshCacheHeader header;
+    memcpy(header.magic, "PSMC", 4);
+    header.version = MODEL_CACHE_VERSION;
+    header.source_size = GetFileLength(path.c_str());
+    header.source_mtime = GetFileModTime(path.c_str());
+    header.mesh_count = model.meshCount;
+    fd.write((const char*)&header, sizeof(header));
+    for (int i=0; i<model.meshCount; i++) {
+        const Mesh& mesh = model.meshes[i];
+        size_t vc = mesh.vertexCount;
+        MeshCacheMesh info = {(uint32_t)mesh.vertexCount, (uint32_t)mesh.triangleCount, 0};
+        if (mesh.texcoords != nullptr) info.flags |= MESH_HAS_TEXCOORDS;
+        if (mesh.texcoords2 != nullptr) info.flags |= MESH_HAS_TEXCOORDS2;
+        if (mesh.normals != nullptr) info.flags |= MESH_HAS_NORMALS;
+        if (mesh.tangents != nullptr) info.flags |= MESH_HAS_TANGENTS;
+        if (mesh.colors != nullptr) info.flags |= MESH_HAS_COLORS;
+        if (mesh.indices != nullptr) info.flags |= MESH_HAS_INDICES;
+        fd.write((const char*)&info, sizeof(info));
+        fd.write((const char*)mesh.vertices, vc*3*sizeof(float));
+        if (mesh.texcoords != nullptr) fd.write((const char*)mesh.texcoords, vc*2*sizeof(float));
+        if (mesh.texcoords2 != nullptr) fd.write((const char*)mesh.texcoords2, vc*2*sizeof(float));
+        if (mesh.normals != nullptr) fd.write((const char*)mesh.normals, vc*3*sizeof(float));
+        if (mesh.tangents != nullptr) fd.write((const char*)mesh.tangents, vc*4*sizeof(float));
+        if (mesh.colors != nullptr) fd.write((const char*)mesh.colors, vc*4);
+        if (mesh.indices != nullptr) fd.write((const char*)mesh.indices, mesh.triangleCount*3*sizeof(unsigned short));
+    }
+    fd.close();
+    std::filesystem::rename(tmpPath, cachePath, err);
+    if (err) {
+        TraceLog(LOG_WARNING, "Failed to write model cache %s: %s", cachePath.c_str(), err.message().c_str());
+    }
+}
+
+// Parse an OBJ file into CPU-side meshes without touching the GL context.
+// Materials are skipped since the draw path only uses mesh data.
+bool ParseOBJ(const std::string& path, Model& model) {
+    char* text = LoadFileText(path.c_str());
+    if (text == nullptr) return false;
+    tinyobj_attrib_t attrib = {0};
+    tinyobj_shape_t* shapes = nullptr;
+    unsigned int shapeCount = 0;
+    tinyobj_material_t* materials = nullptr;
+    unsigned int materialCount = 0;
+    // shapes count `f` lines, so faces are kept whole (one face_num_verts entry per line) and fanned into triangles here
+    int ret = tinyobj_parse_obj(&attrib, &shapes, &shapeCount, &materials, &materialCount,
+        text, strlen(text), 0);
+    UnloadFileText(text);
+    if (ret != TINYOBJ_SUCCESS || shapeCount == 0) {
+        tinyobj_attrib_free(&attrib);
+        tinyobj_shapes_free(shapes, shapeCount);
+        tinyobj_materials_free(materials, materialCount);
+        return false;
+    }
+    // where the indices of each face start in attrib.faces
+    std::vector<unsigned int> faceStart(attrib.num_faces + 1, 0);
+    for (unsigned int f=0; f<attrib.num_faces; f++) {
+        faceStart[f + 1] = faceStart[f] + attrib.face_num_verts[f];
+    }
+    model.meshCount = shapeCount;
+    model.meshes = (Mesh*)RL_CALLOC(model.meshCount, sizeof(Mesh));
+    for (int i=0; i<model.meshCount; i++) {
+        unsigned int first = std::min(shapes[i].face_offset, attrib.num_faces);
+        unsigned int last = std::min(shapes[i].face_offset + shapes[i].length, attrib.num_faces);
+        unsigned int tris = 0;
+        for (unsigned int f=first; f<last; f++) {
+            if (attrib.face_num_verts[f] >= 3) tris += attrib.face_num_verts[f] - 2;
+        }
+        Mesh& mesh = model.meshes[i];
+        mesh.vertexCount = tris*3;
+        mesh.triangleCount = tris;
+        mesh.vertices = (float*)RL_CALLOC(mesh.vertexCount*3, sizeof(float));
+        mesh.texcoords = (float*)RL_CALLOC(mesh.vertexCount*2, sizeof(float));
+        mesh.normals = (float*)RL_CALLOC(mesh.vertexCount*3, sizeof(float));
+        unsigned int v = 0;
+        for (unsigned int f=first; f<last; f++) {
+            // same fan as tinyobj's triangulation: (0, k-1, k)
+            for (int k=2; k<attrib.face_num_verts[f]; k++) {
+                const int corners[3] = {0, k - 1, k};
+                for (int c : corners) {
+                    tinyobj_vertex_index_t idx = attrib.faces[faceStart[f] + c];
+                    if (idx.v_idx >= 0 && (unsigned int)idx.v_idx < attrib.num_vertices) {
+                        for (int n=0; n<3; n++) mesh.vertices[v*3 + n] = attrib.vertices[idx.v_idx*3 + n];
+                    }
+                    // faces without texcoords or normals have -1 indices, those keep zeros
+                    if (idx.vt_idx >= 0 && (unsigned int)idx.vt_idx < attrib.num_texcoords) {
+                        mesh.texcoords[v*2 + 0] = attrib.texcoords[idx.vt_idx*2 + 0];
+                        mesh.texcoords[v*2 + 1] = 1.0f - attrib.texcoords[idx.vt_idx*2 + 1];
+                    }
+                    if (idx.vn_idx >= 0 && (unsigned int)idx.vn_idx < attrib.num_normals) {
+                        for (int n=0; n<3; n++) mesh.normals[v*3 + n] = attrib.normals[idx.vn_idx*3 + n];
+                    }
+                    v++;
+                }
+            }
+        }
+    }
+    tinyobj_attrib_free(&attrib);
+    tinyobj_shapes_free(shapes, shapeCount);
+    tinyobj_materials_free(materials, materialCount);
+    return true;
+}
+
+void Run() {
+    while (true) {
+        std::string path;
+        Entry* entry;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [] { return stopping || !queue.empty(); });
+            if (stopping) return;
+            path = queue.front();
+            queue.pop_front();
+            entry = entries[path];
+            entry->stage = STAGE_PARSING;
+        }
+        Model model = {0};
+        LoadStage stage = STAGE_PARSED;
+        if (!FileExists(path.c_str())) {
+            stage = STAGE_FAILED;
+        } else if (ReadMeshCache(path, model)) {
+            TraceLog(LOG_INFO, "Loaded %d meshes for %s from model cache", model.meshCount, path.c_str());
+        } else if (IsFileExtension(path.c_str(), ".obj")) {
+            if (ParseOBJ(path, model)) {
+                WriteMeshCache(path, model);
+            } else {
+                stage = STAGE_FAILED;
+            }
+        } else {
+            // other formats go through raylib, which uploads as it loads
+            stage = STAGE_NEEDS_SYNC_LOAD;
+        }
+        if (stage == STAGE_FAILED) {
+            TraceLog(LOG_WARNING, "Failed to load model %s!", path.c_str());
+        }
+        MeshBVH bounds;
+        if (stage == STAGE_PARSED) {
+            bounds.Build(model);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        entry->bounds = std::move(bounds);
+        entry->model = model;
+        entry->stage = stage;
+    }
+}
+
+void Request(std::string path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it != entries.end()) {
+        it->second->refs++;
+        return;
+    }
+    Entry* entry = new Entry;
+    entry->refs = 1;
+    entries[path] = entry;
+    Mesh mesh = {0};
+    if (path == "(sphere)") {
+        mesh = GenMeshSphere(1.0, 40.0, 20.0);
+    } else if (path == "(cube)") {
+        mesh = GenMeshCube(1.0, 1.0, 1.0);
+    } else if (path == "(donut)") {
+        mesh = GenMeshTorus(0.5, 2.0, 20.0, 40.0);
+    } else {
+        if (!worker.joinable()) {
+            worker = std::thread(Run);
+        }
+        queue.push_back(path);
+        cv.notify_one();
+        return;
+    }
+    entry->model = LoadModelFromMesh(mesh);
+    entry->bounds.Build(entry->model);
+    entry->stage = STAGE_READY;
+}
+
+ModelState Get(std::string path, Model& model) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end()) {
+        return MODEL_FAILED;
+    }
+    switch (it->second->stage) {
+        case STAGE_READY:
+            model = it->second->model;
+            return MODEL_READY;
+        case STAGE_FAILED:
+            return MODEL_FAILED;
+        default:
+            return MODEL_LOADING;
+    }
+}
+
+const MeshBVH* GetBounds(std::string path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end() || it->second->stage != STAGE_READY) {
+        return nullptr;
+    }
+    return &it->second->bounds;
+}
+
+void Release(std::string path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end()) {
+        return;
+    }
+    it->second->refs--;
+    // entries still being loaded are collected by Poll once the worker is done with them
+    if (it->second->refs <= 0 && (it->second->stage == STAGE_READY || it->second->stage == STAGE_FAILED)) {
+        if (it->second->stage == STAGE_READY) {
+            UnloadEntryModel(it->second);
+        }
+        delete it->second;
+        entries.erase(it);
+    }
+}
+
+void Reload(std::string path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    // a load that hasn't started will read the new file anyway
+    if (it == entries.end() || it->second->stage == STAGE_QUEUED || it->second->stage == STAGE_NEEDS_SYNC_LOAD ||
+        !FileExists(path.c_str())) {
+        return;
+    }
+    // the references move to a fresh entry, the old one keeps its model until the new one is ready
+    Entry* entry = new Entry;
+    entry->refs = it->second->refs;
+    it->second->refs = 0;
+    retired.push_back({path, it->second, false});
+    it->second = entry;
+    if (!worker.joinable()) {
+        worker = std::thread(Run);
+    }
+    queue.push_back(path);
+    cv.notify_one();
+}
+
+void Poll(float budget) {
+    double start = GetTime();
+    std::vector<std::string> loadSync;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto it = retired.begin(); it != retired.end();) {
+        Entry* entry = it->entry;
+        if (it->replaced && entry->stage != STAGE_QUEUED && entry->stage != STAGE_PARSING) {
+            if (entry->stage == STAGE_PARSED) FreeMeshes(entry->model);
+            else if (entry->stage == STAGE_READY) UnloadEntryModel(entry);
+            delete entry;
+            it = retired.erase(it);
+        } else {
+            it++;
+        }
+    }
+    for (auto it = entries.begin(); it != entries.end();) {
+        Entry* entry = it->second;
+        if (entry->refs <= 0 && entry->stage != STAGE_QUEUED && entry->stage != STAGE_PARSING) {
+            if (entry->stage == STAGE_PARSED) FreeMeshes(entry->model);
+            else if (entry->stage == STAGE_READY) UnloadEntryModel(entry);
+            delete entry;
+            it = entries.erase(it);
+            continue;
+        }
+        if (GetTime() - start < budget) {
+            if (entry->stage == STAGE_PARSED) {
+                Model& model = entry->model;
+                model.transform = MatrixIdentity();
+                model.materialCount = 1;
+                model.materials = (Material*)RL_CALLOC(1, sizeof(Material));
+                model.materials[0] = LoadMaterialDefault();
+                model.meshMaterial = (int*)RL_CALLOC(model.meshCount, sizeof(int));
+                for (int i=0; i<model.meshCount; i++) {
+                    UploadMesh(&model.meshes[i], false);
+                }
+                entry->stage = STAGE_READY;
+                TrackModel(it->first, entry);
+            } else if (entry->stage == STAGE_NEEDS_SYNC_LOAD) {
+                loadSync.push_back(it->first);
+                entry->stage = STAGE_PARSING;
+            }
+        }
+        it++;
+    }
+    lock.unlock();
+    for (auto& path : loadSync) {
+        Model model = ::LoadModel(path.c_str());
+        bool ready = IsModelReady(model) && model.meshCount > 0;
+        MeshBVH bounds;
+        if (ready) {
+            WriteMeshCache(path, model);
+            bounds.Build(model);
+        } else {
+            TraceLog(LOG_WARNING, "Failed to load model %s!", path.c_str());
+        }
+        lock.lock();
+        entries[path]->model = model;
+        entries[path]->bounds = std::move(bounds);
+        entries[path]->stage = ready ? STAGE_READY : STAGE_FAILED;
+        if (ready) {
+            TrackModel(path, entries[path]);
+        }
+        lock.unlock();
+    }
+    lock.lock();
+    for (auto& r : retired) {
+        auto it = entries.find(r.path);
+        r.replaced = it == entries.end() || it->second->stage == STAGE_READY || it->second->stage == STAGE_FAILED;
+    }
+}
+
+void Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+#include <raylib.h>
+
+#include "Culling.hpp"
+
+// Shared, reference counted models keyed by path.
+// Parsing happens on a worker thread (OBJ files and the on-disk mesh cache), only the
+// VBO upload is done on the render thread from Poll().
+// Parsed meshes are written to a compact binary cache so later loads only have to map the file and upload.
+namespace ModelCache {
+    typedef enum {
+        MODEL_LOADING = 0,
+        MODEL_READY,
+        MODEL_FAILED,
+    } ModelState;
+
+    // Add a reference to the model at path, starting a load if it isn't already cached.
+    void Request(std::string path);
+    // Get the model at path, model is only filled in once the state is MODEL_READY.
+    ModelState Get(std::string path, Model& model);
+    // Per-mesh bounds of a ready model, valid for as long as the model is referenced.
+    const MeshBVH* GetBounds(std::string path);
+    // Drop a reference added by Request, unloading the model when none remain.
+    void Release(std::string path);
+    // Load the model at path again after the file changed, the old model stays valid until the new one is
+    // ready and the Poll after that, so holders should Get it again every frame. Does nothing if it isn't cached.
+    void Reload(std::string path);
+    // Upload parsed meshes on the render thread, spending at most roughly budget seconds.
+    void Poll(float budget);
+    void Shutdown();
+}
@@ -1,9 +1,11 @@
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <ctime>
 #include <map>
 #include <fstream>
+#include <iterator>
 #include <string>
 #include <utility>
 #include <vector>
@@ -14,7 +16,14 @@
 #include <rlImGui.h>
 
 #include "PixelShader.hpp"
+#include "AnimatedTexture.hpp"
 #include "FileDialogs.hpp"
+#include "FileIndex.hpp"
+#include "MemoryTracker.hpp"
+#include "ModelCache.hpp"
+#include "RenderTargetPool.hpp"
+#include "ResourceLoader.hpp"
+#include "ShaderCompiler.hpp"
 #include "external/msf_gif.h"
 #include "nlohmann/json.hpp"
 #include "ImGuiColorTextEdit/TextEditor.h"
@@ -52,19 +61,27 @@ const char* vertex_shader_code_model =
 "in vec2 vertexTexCoord;\n"
 "in vec4 vertexColor;\n"
 "in vec3 vertexNormal;\n"
+"// per-instance attributes, see PixelShader::UpdateInstances\n"
+"layout(location = 6) in mat4 instanceTransform;\n"
+"layout(location = 10) in vec4 instanceParam;\n"
 "out vec2 fragTexCoord;\n"
 "out vec4 fragColor;\n"
 "out vec3 fragPosition;\n"
 "out vec3 fragNormal;\n"
+"out vec4 fragInstanceParam;\n"
+"flat out int fragInstanceID;\n"
 "uniform mat4 mvp;\n"
 "uniform mat4 matNormal;\n"
 "void main()\n"
 "{\n"
+"\tvec4 worldPosition = instanceTransform*vec4(vertexPosition, 1.0);\n"
 "\tfragTexCoord = vertexTexCoord;\n"
-"\tfragPosition = vertexPosition;\n"
+"\tfragPosition = worldPosition.xyz;\n"
 "\tfragColor = vertexColor;\n"
-"\tfragNormal = normalize(vec3(matNormal * vec4(vertexNormal, 0.0)));\n"
-"\tgl_Position = mvp*vec4(vertexPosition, 1.0);\n"
+"\tfragNormal = normalize(vec3(matNormal * instanceTransform * vec4(vertexNormal, 0.0)));\n"
+"\tfragInstanceParam = instanceParam;\n"
+"\tfragInstanceID = gl_InstanceID;\n"
+"\tgl_Position = mvp*worldPosition;\n"
 "}\n";
 
 const char* fragment_shader_code_default =
@@ -123,6 +140,7 @@ unsigned int numLoadedShadersEver = 0;
 std::vector<unsigned int> texturesNeedingCleanup;
 extern FileDialogs::FileDialogManager fileDialogManager;
 extern std::map<int, PixelShader*> pixelShaders;
+PixelShader* GetPixelShader(int id);
 
 #pragma endregion
 
@@ -146,7 +164,14 @@ void DrawEmptyTriangleStrip() {
     glBindVertexArray(0);
 }
 
+size_t TextureBytes(const Texture2D& tex) {
+    size_t bytes = GetPixelDataSize(tex.width, tex.height, tex.format);
+    // a full mipmap chain adds a third
+    return tex.mipmaps > 1 ? bytes * 4 / 3 : bytes;
+}
+
 void PushBackTextureNeedingCleanup(const Texture2D& tex) {
+    MemoryTracker::Track(MEMORY_TEXTURES, tex.id, TextureBytes(tex));
     for (int i=0; i<texturesNeedingCleanup.size(); i++) {
         if (texturesNeedingCleanup[i] == -1) {
             texturesNeedingCleanup[i] = tex.id;
@@ -166,9 +191,15 @@ int TextureNeedsCleanup(const Texture2D& tex) {
 }
 
 void CleanupTexture(Texture2D& tex) {
+    unsigned int id = tex.id;
+    if (UnloadAnimatedTexture(tex)) {
+        MemoryTracker::Untrack(MEMORY_TEXTURES, id);
+        return;
+    }
     int i = TextureNeedsCleanup(tex);
     if (i != -1) {
         TraceLog(LOG_DEBUG, "Cleaning up texture ID %u", tex.id);
+        MemoryTracker::Untrack(MEMORY_TEXTURES, tex.id);
         UnloadTexture(tex);
         texturesNeedingCleanup[i] = -1;
         tex = {0};
@@ -199,12 +230,22 @@ Texture2D LoadTextureFromString(const char* str) {
         int psid = -1;
         sscanf(str, "(Shader Output %u)", &psid);
         if (psid >= 0) {
-            if (pixelShaders.count(psid) >= 1) {
-                auto ps = pixelShaders[psid];
+            // loads the shader if it is still waiting in the workspace
+            PixelShader* ps = GetPixelShader(psid);
+            if (ps != nullptr) {
                 return ps->renderTexture.texture;
             }
         }
     } 
+    if (IsAnimatedTextureSource(str)) {
+        tex = LoadAnimatedTexture(str);
+        if (IsTextureReady(tex)) {
+            MemoryTracker::Track(MEMORY_TEXTURES, tex.id, TextureBytes(tex), MEMORY_NO_OWNER, str);
+            return tex;
+        }
+        TraceLog(LOG_WARNING, "Failed to load animated image %s!", str);
+        return BlankTexture();
+    }
     if (!memcmp(str, "rgb(", 4)) {
         sscanf(str, "rgb(%d,%d,%d)", &r, &g, &b);
         generate_image_texture = true;
@@ -220,10 +261,13 @@ Texture2D LoadTextureFromString(const char* str) {
         PushBackTextureNeedingCleanup(tex);
         UnloadImage(image);
     } else {
-        tex = LoadTexture(str);
+        // images requested ahead by ResourceLoader only need uploading
+        Image prefetched;
+        tex = ResourceLoader::GetImage(str, prefetched) ? LoadTextureFromImage(prefetched) : LoadTexture(str);
         if (IsTextureReady(tex)) {
             GenTextureMipmaps(&tex);
             PushBackTextureNeedingCleanup(tex);
+            MemoryTracker::Track(MEMORY_TEXTURES, tex.id, TextureBytes(tex), MEMORY_NO_OWNER, str);
         } else {
             TraceLog(LOG_WARNING, "Failed to load image file %s!", str);
             tex = BlankTexture();
@@ -290,18 +334,33 @@ class BrowseFilenameCB : public FileDialogs::Callback {
 PixelShader::PixelShader(const char* fname) : PixelShader() {
     filename = strdup(fname);
     if (filename != nullptr) {
-        Load(filename);
         num = numLoadedShadersEver++;
         name = "Shader " + std::to_string(num);
+        Load(filename);
     }
 }
 
 PixelShader::PixelShader(const char* fname, int id) : PixelShader() {
     filename = strdup(fname);
     if (filename != nullptr) {
+        num = id;
+        if (id >= (int)numLoadedShadersEver) {
+            numLoadedShadersEver = id + 1;
+        }
+        name = "Shader " + std::to_string(num);
         Load(filename);
+    }
+}
+
+PixelShader::PixelShader(const char* fname, int id, const std::string& code, Shader compiled) : PixelShader() {
+    filename = strdup(fname);
+    if (filename != nullptr) {
         num = id;
+        if (id >= (int)numLoadedShadersEver) {
+            numLoadedShadersEver = id + 1;
+        }
         name = "Shader " + std::to_string(num);
+        Load(filename, code, compiled);
     }
 }
 
@@ -338,6 +397,15 @@ bool PixelShader::IsReady() {
     return IsShaderReady(pixelShader);
 }
 
+// encoded frames plus the two frames and LZW table the encoder keeps while recording
+size_t GifBytes(const MsfGifState& state) {
+    size_t bytes = (size_t)state.width * state.height * 4 * 2 + 4096 * 256 * sizeof(int16_t);
+    for (MsfGifBuffer* b = state.listHead; b != nullptr; b = b->next) {
+        bytes += b->size;
+    }
+    return bytes;
+}
+
 void PixelShader::Update(float dt) {
 
     if (saving_sequence || saving_single || saving_gif) {
@@ -351,6 +419,7 @@ void PixelShader::Update(float dt) {
         ImageFlipVertical(&img);
         if (saving_gif) {
             msf_gif_frame(&gifState, (uint8_t*)img.data, dt*100.0f, 16, rt_width*4);
+            MemoryTracker::Track(MEMORY_GIF, num, GifBytes(gifState), num, saving_filename);
         } else {
             if (IsFileExtension(filename.c_str(), ".jpg") || IsFileExtension(filename.c_str(), ".jpeg")) {
                 ImageFormat(&img, PIXELFORMAT_UNCOMPRESSED_R8G8B8);
@@ -365,7 +434,39 @@ void PixelShader::Update(float dt) {
     BeginTextureMode(renderTexture);
     // rlEnableFramebuffer(renderTexture.id);
     ClearBackground(clearColor);
+    Render(dt, 0, 0, rt_width, rt_height);
+    EndTextureMode();
+    // BeginTextureMode(selfTexture);
+    // ClearBackground(BLACK);
+    // Rectangle srcrec {0.0, 0.0, (float)renderTexture.texture.width, (float)renderTexture.texture.height};
+    // Rectangle dstrec {0.0, -(float)renderTexture.texture.height, (float)renderTexture.texture.width, -(float)renderTexture.texture.height};
+    // DrawTexturePro(renderTexture.texture, srcrec, dstrec, {0.0, 0.0}, 0.0, WHITE);
+    // EndTextureMode();
+    std::swap(selfTexture, renderTexture);
+    if (frame_ring != nullptr) {
+        frame_ring->Capture(selfTexture, frame_counter);
+    }
+    frame_counter++;
+    runtime += dt;
+}
 
+// BeginMode3D takes the aspect ratio from the whole framebuffer, a viewport inside it needs its own
+void LoadCameraProjection(const Camera3D& camera, float aspect) {
+    rlMatrixMode(RL_PROJECTION);
+    rlLoadIdentity();
+    if (camera.projection == CAMERA_PERSPECTIVE) {
+        double top = RL_CULL_DISTANCE_NEAR*tan(camera.fovy*0.5*DEG2RAD);
+        double right = top*aspect;
+        rlFrustum(-right, right, -top, top, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+    } else {
+        double top = camera.fovy/2.0;
+        double right = top*aspect;
+        rlOrtho(-right, right, -top, top, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+    }
+    rlMatrixMode(RL_MODELVIEW);
+}
+
+void PixelShader::Render(float dt, int x, int y, int width, int height) {
     if (other_uniform_buffers.count("time") >= 1) {
         other_uniform_buffers["time"].f = runtime;
         SetShaderValue(pixelShader, shader_locs["time"].first, &runtime, SHADER_UNIFORM_FLOAT);
@@ -392,6 +493,7 @@ void PixelShader::Update(float dt) {
             if (!IsTextureReady(im.second)) {
                 im.second = BlankTexture();
             }
+            UpdateAnimatedTexture(im.second, frame_counter, runtime);
             SetShaderValueTexture(pixelShader, p.second.first, im.second);
         }
     }
@@ -414,11 +516,12 @@ void PixelShader::Update(float dt) {
 
     // BeginShaderMode(pixelShader); 
     
-    rlViewport(0, 0, rt_width, rt_height);
+    rlViewport(x, y, width, height);
     switch (drawType) {
         case MODEL:
             if (IsModelReady(model) && model.meshCount > 0) {
                 BeginMode3D(camera);
+                LoadCameraProjection(camera, width/(float)height);
                 glUseProgram(pixelShader.id);
                 Matrix matView = rlGetMatrixModelview();
                 Matrix matProjection = rlGetMatrixProjection();
@@ -439,13 +542,32 @@ void PixelShader::Update(float dt) {
                         }
                     }
                 }
-                for (int i = 0; i < model.meshCount; i++) {
+                UpdateInstances();
+                visibleMeshes.clear();
+                cullStats = {0};
+                {
+                    const MeshBVH* bounds = culling ? ModelCache::GetBounds(modelPath) : nullptr;
+                    if (bounds != nullptr && (int)bounds->boxes.size() == model.meshCount) {
+                        Frustum frustum(MatrixMultiply(matView, matProjection));
+                        bounds->Cull(frustum, instanceMin, instanceMax, visibleMeshes, cullStats);
+                    } else {
+                        for (int i = 0; i < model.meshCount; i++) visibleMeshes.push_back(i);
+                        cullStats.total = model.meshCount;
+                    }
+                }
+                cullStats.visible = visibleMeshes.size();
+                for (int i : visibleMeshes) {
                     Mesh& mesh = model.meshes[i];
+                    cullStats.triangles += mesh.triangleCount * instance_count;
                     rlEnableVertexArray(mesh.vaoId);
+                    // mesh VAOs are shared between shaders through the model cache,
+                    // so the instance attributes are pointed at this shader's buffer before every draw
+                    BindInstanceAttributes();
                     // Draw mesh
-                    if (mesh.indices != NULL) rlDrawVertexArrayElements(0, mesh.triangleCount*3, 0);
-                    else rlDrawVertexArray(0, mesh.vertexCount);
+                    if (mesh.indices != NULL) rlDrawVertexArrayElementsInstanced(0, mesh.triangleCount*3, 0, instance_count);
+                    else rlDrawVertexArrayInstanced(0, mesh.vertexCount, instance_count);
                 }
+                rlDisableVertexArray();
                 EndMode3D();
             }
             break;
@@ -456,16 +578,6 @@ void PixelShader::Update(float dt) {
             break;
     }
     // EndShaderMode();
-    EndTextureMode();
-    // BeginTextureMode(selfTexture);
-    // ClearBackground(BLACK);
-    // Rectangle srcrec {0.0, 0.0, (float)renderTexture.texture.width, (float)renderTexture.texture.height};
-    // Rectangle dstrec {0.0, -(float)renderTexture.texture.height, (float)renderTexture.texture.width, -(float)renderTexture.texture.height};
-    // DrawTexturePro(renderTexture.texture, srcrec, dstrec, {0.0, 0.0}, 0.0, WHITE);
-    // EndTextureMode();
-    std::swap(selfTexture, renderTexture);
-    frame_counter++;
-    runtime += dt;
 }
 
 void LoadUniformsFromCode(const char* code, int len,
@@ -623,59 +735,94 @@ void LoadUniformsFromCode(const char* code, int len,
 }
 
 
+// "#type: model" anywhere in the code selects the model vertex shader
+ShaderDrawType DetectDrawType(const char* code, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        if (!memcmp(&code[i], "#type: ", strlen("#type: "))) {
+            i += strlen("#type: ");
+            while (isspace(code[i]) && i < len) i++;
+            if (!memcmp(&code[i], "model", strlen("model"))) {
+                return ShaderDrawType::MODEL;
+            }
+        } else {
+            i++;
+        }
+    }
+    return ShaderDrawType::TEXTURE;
+}
+
 bool PixelShader::Load(const char* filename) {
     std::ifstream fd(filename, std::ios::in | std::ios::binary);
-    char* fragment_code;
-    size_t len = 0;
+    std::string code;
     drawType = ShaderDrawType::NONE;
     if (fd.is_open()) {
-        fd.seekg(0, std::ios::end);
-        len = fd.tellg();
-        fd.seekg(0, std::ios::beg);
-        fragment_code = new char[len+1];
-        fd.read(fragment_code, len);
-        fragment_code[len] = 0;
+        code.assign(std::istreambuf_iterator<char>(fd), std::istreambuf_iterator<char>());
         fd.close();
     }
-    if (len == 0) {
+    if (code.size() == 0) {
         return false;
     }
-    // check for shader type
-    drawType = ShaderDrawType::TEXTURE;
-    size_t i = 0;
-    while (i < len) {
-        if (!memcmp(&fragment_code[i], "#type: ", strlen("#type: "))) {
-            i += strlen("#type: ");
-            while (isspace(fragment_code[i]) && i < len) i++;
-            if (!memcmp(&fragment_code[i], "model", strlen("model"))) {
-                drawType = ShaderDrawType::MODEL;
-                break;
-            }
-        } else {
-            i++;
-        }
+    return Load(filename, code, {0});
+}
+
+bool PixelShader::Load(const char* filename, const std::string& code, Shader compiled) {
+    ShaderPreprocessor::Result source;
+    if (!ShaderPreprocessor::Process(filename, code, source)) {
+        TraceLog(LOG_WARNING, "%s:%d: %s", filename, source.error_line, source.error.c_str());
+        return false;
     }
+    drawType = DetectDrawType(source.code.c_str(), source.code.size());
     Shader newPixelShader;
     const char* vertex_code;
     switch (drawType) {
         case MODEL:
             TraceLog(LOG_INFO, "Loading model shader.");
-            newPixelShader = LoadShaderFromMemory(vertex_code = vertex_shader_code_model, fragment_code);
+            vertex_code = vertex_shader_code_model;
             LoadModel("(sphere)");
             break;
         case TEXTURE:
         default:
             TraceLog(LOG_INFO, "Loading pixel shader.");
-            newPixelShader = LoadShaderFromMemory(vertex_code = vertex_shader_code_default, fragment_code);
+            vertex_code = vertex_shader_code_default;
             break;
     }
+    source_code = source.code;
+    variant_keys = ShaderPreprocessor::FindVariants(source_code);
+    std::string program = ProgramSource(variant_selection, {});
+    // compiled is built from the same code with the default variants by ResourceLoader,
+    // when it isn't usable the code is compiled here
+    newPixelShader = compiled.id != 0 ? compiled : LoadShaderFromMemory(vertex_code, program.c_str());
     if (!IsShaderReady(newPixelShader)) {
-        delete[] fragment_code;
         return false;
     }
-    if (IsShaderReady(pixelShader)) {
-        UnloadShader(pixelShader);
+    ClearPrograms();
+    programs[program] = newPixelShader;
+    program_key = program;
+    UseShader(newPixelShader, program.c_str(), program.size(), vertex_code);
+
+    std::error_code err;
+    file_time = std::filesystem::last_write_time(filename, err);
+    unsaved = false;
+    includes.assign(source.files.begin() + 1, source.files.end());
+    editor.SetText(code);
+    editor.SetErrorMarkers(TextEditor::ErrorMarkers());
+    if (IsFileExtension(filename, ".glsl") || IsFileExtension(filename, ".fs") || IsFileExtension(filename, ".vs")) {
+        editor.SetLanguageDefinition(TextEditor::LanguageDefinition::GLSL());
+    } else if (IsFileExtension(filename, ".hlsl")) {
+        editor.SetLanguageDefinition(TextEditor::LanguageDefinition::HLSL());
+    } else if (IsFileExtension(filename, ".cpp") || IsFileExtension(filename, ".hpp")) {
+        editor.SetLanguageDefinition(TextEditor::LanguageDefinition::CPlusPlus());
+    } else if (IsFileExtension(filename, ".c") || IsFileExtension(filename, ".h")) {
+        editor.SetLanguageDefinition(TextEditor::LanguageDefinition::C());
+    } else {
+        editor.SetLanguageDefinition(TextEditor::LanguageDefinition::GLSL());
     }
+    return true;
+}
+
+// the previous program is left in programs, it is unloaded with the rest by ClearPrograms
+void PixelShader::UseShader(Shader newPixelShader, const char* fragment_code, size_t len, const char* vertex_code) {
     pixelShader = newPixelShader;
 
     std::map<std::string, Uniform> new_other_uniform_buffers;
@@ -695,22 +842,345 @@ bool PixelShader::Load(const char* filename) {
     for (auto r : to_remove) {
         shader_locs.erase(r);
     }
+    other_uniform_buffers = new_other_uniform_buffers;
+}
 
-    editor.SetText(fragment_code);
-    if (IsFileExtension(filename, ".glsl") || IsFileExtension(filename, ".fs") || IsFileExtension(filename, ".vs")) {
-        editor.SetLanguageDefinition(TextEditor::LanguageDefinition::GLSL());
-    } else if (IsFileExtension(filename, ".hlsl")) {
-        editor.SetLanguageDefinition(TextEditor::LanguageDefinition::HLSL());
-    } else if (IsFileExtension(filename, ".cpp") || IsFileExtension(filename, ".hpp")) {
-        editor.SetLanguageDefinition(TextEditor::LanguageDefinition::CPlusPlus());
-    } else if (IsFileExtension(filename, ".c") || IsFileExtension(filename, ".h")) {
-        editor.SetLanguageDefinition(TextEditor::LanguageDefinition::C());
+// GLSL type and literal for a uniform value, empty for types that can't be baked
+const char* UniformTypeName(ShaderUniformType type) {
+    switch (type) {
+        case INT: return "int";
+        case FLOAT: case SLIDER: return "float";
+        case VEC2: case SLIDER2: return "vec2";
+        case VEC3: case SLIDER3: case COLOR3: return "vec3";
+        case VEC4: case SLIDER4: case COLOR4: return "vec4";
+        default: return "";
+    }
+}
+
+std::string FloatLiteral(float f) {
+    std::string s = TextFormat("%.9g", f);
+    if (s.find_first_of(".eE") == std::string::npos) {
+        s += ".0";
+    }
+    return s;
+}
+
+std::string UniformLiteral(ShaderUniformType type, const Uniform& value) {
+    std::string components;
+    int n = 0;
+    switch (type) {
+        case INT: return std::to_string(value.i);
+        case FLOAT: case SLIDER: return FloatLiteral(value.f);
+        case VEC2: case SLIDER2: n = 2; break;
+        case VEC3: case SLIDER3: case COLOR3: n = 3; break;
+        case VEC4: case SLIDER4: case COLOR4: n = 4; break;
+        default: return "";
+    }
+    for (int i=0; i<n; i++) {
+        components += (i > 0 ? ", " : "") + FloatLiteral(value.v[i]);
+    }
+    return std::string(UniformTypeName(type)) + "(" + components + ")";
+}
+
+// the name a declarator ("b", "c = 1.0") declares, the last identifier before its initializer, empty for arrays
+static std::string DeclaratorName(const std::string& code, size_t begin, size_t end, size_t* name_start) {
+    size_t stop = std::min(code.find('=', begin), end);
+    while (stop > begin && isspace(code[stop - 1])) stop--;
+    size_t start = stop;
+    while (start > begin && (isalnum(code[start - 1]) || code[start - 1] == '_')) start--;
+    *name_start = start;
+    return code.substr(start, stop - start);
+}
+
+// text from begin to end on one line and without the whitespace around it
+static std::string Flatten(const std::string& code, size_t begin, size_t end) {
+    std::string s = code.substr(begin, end - begin);
+    for (auto& c : s) {
+        if (c == '\n' || c == '\r') c = ' ';
+    }
+    size_t first = s.find_first_not_of(" \t");
+    size_t last = s.find_last_not_of(" \t");
+    return first == std::string::npos ? "" : s.substr(first, last - first + 1);
+}
+
+// Replace the declarations of the given uniforms with constants, keeping the line count the same.
+// A declaration of several uniforms ("uniform float a, b;") keeps the ones that aren't baked.
+std::string BakeUniforms(const std::string& code, const std::vector<SavedUniform>& values) {
+    std::map<std::string, const SavedUniform*> byName;
+    for (auto& v : values) {
+        byName[v.name] = &v;
+    }
+    std::string baked;
+    baked.reserve(code.size());
+    size_t pos = 0;
+    while (pos < code.size()) {
+        size_t eol = code.find('\n', pos);
+        if (eol == std::string::npos) eol = code.size();
+        size_t p = code.find_first_not_of(" \t", pos);
+        size_t semi;
+        if (p < eol && !code.compare(p, strlen("uniform "), "uniform ") &&
+            (semi = code.find(';', p)) != std::string::npos) {
+            // declarators are split at commas outside of parentheses, vec2(1, 2) initializers have them too
+            std::vector<std::pair<size_t, size_t>> declarators;
+            size_t begin = p + strlen("uniform ");
+            int depth = 0;
+            for (size_t i=begin; i<=semi; i++) {
+                char c = code[i];
+                if (c == '(' || c == '[') depth++;
+                else if (c == ')' || c == ']') depth--;
+                else if ((c == ',' && depth == 0) || i == semi) {
+                    declarators.push_back({begin, i});
+                    begin = i + 1;
+                }
+            }
+            std::string type, kept, constants;
+            bool any = false;
+            for (size_t d=0; d<declarators.size(); d++) {
+                size_t start;
+                std::string name = DeclaratorName(code, declarators[d].first, declarators[d].second, &start);
+                if (d == 0) {
+                    // the first one starts with the type
+                    type = Flatten(code, p + strlen("uniform "), start);
+                    declarators[d].first = start;
+                }
+                auto it = name.empty() ? byName.end() : byName.find(name);
+                if (it != byName.end()) {
+                    const SavedUniform& u = *it->second;
+                    constants += std::string(constants.empty() ? "" : " ") + "const " + UniformTypeName(u.type) + " " + u.name +
+                        " = " + UniformLiteral(u.type, u.value) + ";";
+                    any = true;
+                } else {
+                    kept += (kept.empty() ? "" : ", ") + Flatten(code, declarators[d].first, declarators[d].second);
+                }
+            }
+            if (any && !type.empty()) {
+                baked.append(code, pos, p - pos);
+                if (!kept.empty()) {
+                    baked += "uniform " + type + " " + kept + "; ";
+                }
+                baked += constants;
+                for (size_t i=p; i<semi; i++) {
+                    if (code[i] == '\n') baked += '\n';
+                }
+                pos = semi + 1;
+                continue;
+            }
+        }
+        baked.append(code, pos, eol + 1 - pos);
+        pos = eol + 1;
+    }
+    return baked;
+}
+
+void PixelShader::SubmitCompile() {
+    if (!ShaderPreprocessor::Process(filename, editor.GetText(), compile_source)) {
+        editor.SetErrorMarkers({{compile_source.error_line, compile_source.error}});
+        compile_status = "include error";
+        return;
+    }
+    includes.assign(compile_source.files.begin() + 1, compile_source.files.end());
+    compile_program = ShaderPreprocessor::ApplyVariants(compile_source.code, variant_selection);
+    compile_type = DetectDrawType(compile_program.c_str(), compile_program.size());
+    const char* vertex_code = compile_type == ShaderDrawType::MODEL ? vertex_shader_code_model : vertex_shader_code_default;
+    ShaderCompiler::Submit(num, vertex_code, compile_program);
+}
+
+void PixelShader::PollCompile() {
+    ShaderCompiler::Result result;
+    if (!ShaderCompiler::Poll(num, result)) {
+        return;
+    }
+    editor.SetErrorMarkers(ShaderPreprocessor::MapMarkers(compile_source, result.markers));
+    compile_status = result.success ? "OK" : std::to_string(result.markers.size()) + " error line(s)";
+    if (!result.success) {
+        TraceLog(LOG_DEBUG, "Background compile of %s failed:\n%s", name.c_str(), result.log.c_str());
+        return;
+    }
+    if (compile_type != drawType) {
+        // switching between texture and model shaders needs the model set up, leave that to a save and reload
+        glDeleteProgram(result.program);
+        compile_status = "OK, save to switch shader type";
+        return;
+    }
+    const char* vertex_code = drawType == ShaderDrawType::MODEL ? vertex_shader_code_model : vertex_shader_code_default;
+    // programs built from the old source are of no use anymore, and baking starts over
+    RestoreBaked();
+    bake_values.clear();
+    ClearPrograms();
+    source_code = compile_source.code;
+    variant_keys = ShaderPreprocessor::FindVariants(source_code);
+    Shader shader = ShaderCompiler::ShaderFromProgram(result.program);
+    programs[compile_program] = shader;
+    program_key = compile_program;
+    UseShader(shader, compile_program.c_str(), compile_program.size(), vertex_code);
+    TraceLog(LOG_DEBUG, "Hot-swapped %s after background compile", name.c_str());
+    // in case a variant was picked while it compiled
+    SwitchProgram();
+}
+
+std::string PixelShader::ProgramSource(const std::map<std::string, std::string>& selection, const std::vector<SavedUniform>& bake) {
+    std::string code = ShaderPreprocessor::ApplyVariants(source_code, selection);
+    return bake.empty() ? code : BakeUniforms(code, bake);
+}
+
+void PixelShader::SelectVariant(const std::string& key, const std::string& value) {
+    variant_selection[key] = value;
+    SwitchProgram();
+}
+
+void PixelShader::Bake() {
+    std::vector<SavedUniform> values;
+    for (auto& name : bake_selection) {
+        auto loc = shader_locs.find(name);
+        auto it = other_uniform_buffers.find(name);
+        if (loc != shader_locs.end() && it != other_uniform_buffers.end() && UniformTypeName(loc->second.second)[0] != 0) {
+            values.push_back({name, loc->second.second, it->second, ""});
+            continue;
+        }
+        // already baked in, keeps its value
+        for (auto& b : baked) {
+            if (b.name == name) {
+                values.push_back(b);
+            }
+        }
+    }
+    bake_values = values;
+    SwitchProgram();
+}
+
+void PixelShader::RevertBake() {
+    bake_values.clear();
+    SwitchProgram();
+}
+
+void PixelShader::PrecompileVariants() {
+    // every combination of values, as long as they fit in the cache
+    std::vector<std::map<std::string, std::string>> combinations = {{}};
+    for (auto& key : variant_keys) {
+        std::vector<std::map<std::string, std::string>> next;
+        for (auto& c : combinations) {
+            for (auto& value : key.values) {
+                next.push_back(c);
+                next.back()[key.name] = value;
+            }
+        }
+        combinations = std::move(next);
+        if (combinations.size() >= SHADER_PROGRAM_CACHE_SIZE) {
+            TraceLog(LOG_WARNING, "%s has too many variants to precompile them all", name.c_str());
+            return;
+        }
+    }
+    for (auto& c : combinations) {
+        std::string code = ProgramSource(c, bake_values);
+        if (programs.count(code) < 1 && std::find(precompile.begin(), precompile.end(), code) == precompile.end()) {
+            precompile.push_back(code);
+        }
+    }
+    CompileNext();
+}
+
+// switch to the program for the picked variants and baked uniforms, compiling it first if it isn't cached
+void PixelShader::SwitchProgram() {
+    std::string key = ProgramSource(variant_selection, bake_values);
+    if (key == program_key) {
+        pending_key.clear();
+        return;
+    }
+    if (programs.count(key) > 0) {
+        pending_key.clear();
+        UseProgram(key);
+        return;
+    }
+    pending_key = key;
+    compile_status = "compiling variant...";
+    CompileNext();
+}
+
+void PixelShader::CompileNext() {
+    std::string next = pending_key;
+    while (next.empty() && !precompile.empty()) {
+        next = precompile.front();
+        precompile.pop_front();
+        if (programs.count(next) > 0) {
+            next.clear();
+        }
+    }
+    if (next.empty() || next == compiling_key) {
+        return;
+    }
+    if (!compiling_key.empty()) {
+        // replaced on the compiler before it finished, it is done once the wanted one is in
+        precompile.push_front(compiling_key);
+    }
+    compiling_key = next;
+    const char* vertex_code = drawType == ShaderDrawType::MODEL ? vertex_shader_code_model : vertex_shader_code_default;
+    // a separate owner from the editor compile, so the two don't replace each other
+    ShaderCompiler::Submit(~num, vertex_code, next);
+}
+
+void PixelShader::PollPrograms() {
+    ShaderCompiler::Result result;
+    if (compiling_key.empty() || !ShaderCompiler::Poll(~num, result)) {
+        return;
+    }
+    std::string key = std::move(compiling_key);
+    compiling_key.clear();
+    if (result.success) {
+        if (programs.size() >= SHADER_PROGRAM_CACHE_SIZE) {
+            for (auto it = programs.begin(); it != programs.end(); it++) {
+                if (it->first != program_key) {
+                    UnloadShader(it->second);
+                    programs.erase(it);
+                    break;
+                }
+            }
+        }
+        programs[key] = ShaderCompiler::ShaderFromProgram(result.program);
+        if (key == pending_key) {
+            pending_key.clear();
+            UseProgram(key);
+            compile_status = "OK";
+        }
     } else {
-        editor.SetLanguageDefinition(TextEditor::LanguageDefinition::GLSL());
+        TraceLog(LOG_WARNING, "Compiling a variant of %s failed:\n%s", name.c_str(), result.log.c_str());
+        if (key == pending_key) {
+            pending_key.clear();
+            compile_status = "variant failed to compile";
+        }
     }
-    // other_uniform_buffers.clear();
-    other_uniform_buffers = new_other_uniform_buffers;
-    return true;
+    CompileNext();
+}
+
+void PixelShader::UseProgram(const std::string& key) {
+    // values baked into the old program go back into the buffers, so UseShader sets them on the new one
+    RestoreBaked();
+    baked = bake_values;
+    program_key = key;
+    const char* vertex_code = drawType == ShaderDrawType::MODEL ? vertex_shader_code_model : vertex_shader_code_default;
+    UseShader(programs[key], key.c_str(), key.size(), vertex_code);
+}
+
+void PixelShader::RestoreBaked() {
+    for (auto& b : baked) {
+        other_uniform_buffers[b.name] = b.value;
+    }
+    baked.clear();
+}
+
+void PixelShader::ClearPrograms() {
+    // ~-1 would be shader 0's editor compile
+    if (num >= 0) {
+        ShaderCompiler::Cancel(~num);
+    }
+    compiling_key.clear();
+    pending_key.clear();
+    precompile.clear();
+    for (auto& p : programs) {
+        UnloadShader(p.second);
+    }
+    programs.clear();
+    program_key.clear();
+    pixelShader = {0};
 }
 
 bool PixelShader::New(const char* filename) {
@@ -720,10 +1190,10 @@ bool PixelShader::New(const char* filename) {
     }
     fd.write(fragment_shader_code_default, strlen(fragment_shader_code_default));
     fd.close();
-    bool success = Load(strdup(filename));
-    shader_locs.clear();
     name = "Shader " + std::to_string(numLoadedShadersEver);
     num = numLoadedShadersEver++;
+    bool success = Load(strdup(filename));
+    shader_locs.clear();
     return success;
 }
 
@@ -731,26 +1201,89 @@ void PixelShader::Reload() {
     int w = rt_width;
     int h = rt_height;
     nlohmann::json j = DumpUniforms();
+    std::string model_file = modelPath;
     Unload();
     Load(filename);
     Setup(w, h);
     LoadUniforms(j);
+    // keep the model instead of going back to the default sphere
+    if (drawType == ShaderDrawType::MODEL && model_file.size() > 0) {
+        LoadModel(model_file);
+    }
+}
+
+void PixelShader::WatchedFiles(std::vector<std::string>& paths) {
+    paths.push_back(filename);
+    paths.insert(paths.end(), includes.begin(), includes.end());
+    // names in parentheses are built in (other shaders' outputs, generated meshes)
+    for (auto& im : image_uniform_buffers) {
+        if (im.second.first[0] != 0 && im.second.first[0] != '(') {
+            paths.push_back(im.second.first);
+        }
+    }
+    if (modelPath.size() > 0 && modelPath[0] != '(') {
+        paths.push_back(modelPath);
+    }
+}
+
+void PixelShader::FileChanged(const std::string& path) {
+    if (path == filename) {
+        std::error_code err;
+        auto time = std::filesystem::last_write_time(filename, err);
+        if (err || time == file_time) {
+            // already loaded, this is our own save
+        } else if (unsaved) {
+            TraceLog(LOG_WARNING, "%s changed on disk, not reloading %s over unsaved edits", filename, name.c_str());
+            compile_status = "file changed on disk";
+        } else {
+            TraceLog(LOG_INFO, "%s changed on disk, reloading %s", filename, name.c_str());
+            Reload();
+        }
+    }
+    if (std::find(includes.begin(), includes.end(), path) != includes.end()) {
+        // the editor buffer is compiled, so unsaved edits to the shader itself are kept
+        TraceLog(LOG_INFO, "%s changed on disk, recompiling %s", path.c_str(), name.c_str());
+        compile_status = "compiling...";
+        SubmitCompile();
+    }
+    for (auto& im : image_uniform_buffers) {
+        if (path == im.second.first) {
+            std::string image = path;
+            SetUniform(im.first, SAMPLER2D, (void*)image.c_str());
+        }
+    }
 }
 
 void PixelShader::Unload() {
+    ShaderCompiler::Cancel(num);
+    compile_pending = false;
+    RestoreBaked();
+    bake_values.clear();
     // CleanupTexture(albedo_tex);
-    UnloadRenderTexture(renderTexture);
-    UnloadRenderTexture(selfTexture);
-    UnloadShader(pixelShader);
+    RenderTargetPool::Release(renderTexture);
+    RenderTargetPool::Release(selfTexture);
+    delete frame_ring;
+    frame_ring = nullptr;
+    ClearPrograms();
     renderTexture = {0};
     selfTexture = {0};
-    pixelShader = {0};
+    if (instanceVbo != 0) {
+        glDeleteBuffers(1, &instanceVbo);
+        MemoryTracker::Untrack(MEMORY_INSTANCES, num);
+        instanceVbo = 0;
+        instances_dirty = true;
+    }
     if (drawType == ShaderDrawType::MODEL) {
-        if (IsModelReady(model)) {
-            UnloadModel(model);
+        if (modelPath.size() > 0) {
+            ModelCache::Release(modelPath);
         }
-        delete modelFilebuf;
+        if (modelPending.size() > 0) {
+            ModelCache::Release(modelPending);
+        }
+        delete[] modelFilebuf;
         model = {0};
+        modelPath.clear();
+        modelPending.clear();
         modelFilebuf = nullptr;
     }
 }
@@ -759,16 +1292,25 @@ void PixelShader::Setup(int width, int height) {
     // albedo_tex = BlankTexture();
     rt_width = width;
     rt_height = height;
-    renderTexture = LoadRenderTexture(rt_width, rt_height);
-    selfTexture = LoadRenderTexture(rt_width, rt_height);
+    renderTexture = RenderTargetPool::Acquire(rt_width, rt_height, num);
+    selfTexture = RenderTargetPool::Acquire(rt_width, rt_height, num);
 }
 
 void PixelShader::SetRTSize(int width, int height) {
-    UnloadRenderTexture(renderTexture);
-    UnloadRenderTexture(selfTexture);
+    RenderTargetPool::Release(renderTexture);
+    RenderTargetPool::Release(selfTexture);
     Setup(width, height);
 }
 
+void PixelShader::PublishFrames(bool enable) {
+    if (enable && frame_ring == nullptr) {
+        frame_ring = new FrameRing(SharedMemory::SegmentName("s" + std::to_string(num)), num);
+    } else if (!enable) {
+        delete frame_ring;
+        frame_ring = nullptr;
+    }
+}
+
 void PixelShader::SetClearColor(int r, int g, int b, int a) {
     clearColor.r = r;
     clearColor.g = g;
@@ -777,29 +1319,127 @@ void PixelShader::SetClearColor(int r, int g, int b, int a) {
 }
 
 void PixelShader::LoadModel(std::string filename) {
-    Model newModel;
-    if (filename == "(sphere)") {
-        newModel = LoadModelFromMesh(GenMeshSphere(1.0, 40.0, 20.0));
-    } else if (filename == "(cube)") {
-        newModel = LoadModelFromMesh(GenMeshCube(1.0, 1.0, 1.0));
-    } else if (filename == "(donut)") {
-        newModel = LoadModelFromMesh(GenMeshTorus(0.5, 2.0, 20.0, 40.0));
-    } else {
-        newModel = ::LoadModel(filename.c_str());
+    if (filename == modelPath || filename == modelPending) {
+        return;
     }
-    if (IsModelReady(newModel)) {
-        if (IsModelReady(model)) {
-            UnloadModel(model);
-        }
-        model = newModel;
-        if (modelFilebuf == nullptr) {
-            modelFilebuf = new char[IMAGE_NAME_BUFFER_LENGTH];
+    if (modelPending.size() > 0) {
+        ModelCache::Release(modelPending);
+    }
+    // the model is swapped in by PollModel once the cache has it uploaded
+    modelPending = filename;
+    ModelCache::Request(filename);
+    PollModel();
+}
+
+void PixelShader::Poll() {
+    PollModel();
+    PollCompile();
+    PollPrograms();
+}
+
+void PixelShader::PollModel() {
+    if (modelPending.empty()) {
+        // pick up the model again in case the cache reloaded it
+        if (modelPath.size() > 0 && ModelCache::Get(modelPath, model) == ModelCache::MODEL_FAILED) {
+            model = {0};
         }
-        strncpy(modelFilebuf, filename.c_str(), IMAGE_NAME_BUFFER_LENGTH-1);
-        modelFilebuf[IMAGE_NAME_BUFFER_LENGTH-1] = 0;
+        return;
+    }
+    Model newModel;
+    switch (ModelCache::Get(modelPending, newModel)) {
+        case ModelCache::MODEL_READY:
+            if (modelPath.size() > 0) {
+                ModelCache::Release(modelPath);
+            }
+            model = newModel;
+            modelPath = modelPending;
+            if (modelFilebuf == nullptr) {
+                modelFilebuf = new char[IMAGE_NAME_BUFFER_LENGTH];
+            }
+            strncpy(modelFilebuf, modelPath.c_str(), IMAGE_NAME_BUFFER_LENGTH-1);
+            modelFilebuf[IMAGE_NAME_BUFFER_LENGTH-1] = 0;
+            modelPending.clear();
+            break;
+        case ModelCache::MODEL_FAILED:
+            ModelCache::Release(modelPending);
+            modelPending.clear();
+            break;
+        default:
+            break;
+    }
+}
+
+
+void PixelShader::UpdateInstances() {
+    if (!instances_dirty && instanceVbo != 0) {
+        return;
+    }
+    instances_dirty = false;
+    if (instance_count < 1) {
+        instance_count = 1;
+    }
+    // lay instances out in a line, square or cube centered on the origin,
+    // instanceParam holds the normalized position along each axis and the normalized index
+    int n = instance_count;
+    int side = 1;
+    switch (instance_layout) {
+        case INSTANCE_LAYOUT_LINE:
+            side = n;
+            break;
+        case INSTANCE_LAYOUT_GRID:
+            side = (int)ceilf(sqrtf((float)n));
+            break;
+        case INSTANCE_LAYOUT_CUBE:
+            side = (int)ceilf(cbrtf((float)n));
+            break;
+        default:
+            break;
     }
+    if (side < 1) side = 1;
+    std::vector<float> data(n * INSTANCE_FLOATS);
+    float center = (side - 1) * 0.5f;
+    instanceMin = instanceMax = Vector3Zero();
+    for (int i = 0; i < n; i++) {
+        int x = i % side;
+        int y = (i / side) % side;
+        int z = i / (side * side);
+        if (instance_layout == INSTANCE_LAYOUT_SINGLE) x = y = z = 0;
+        else if (instance_layout == INSTANCE_LAYOUT_LINE) y = z = 0;
+        else if (instance_layout == INSTANCE_LAYOUT_GRID) z = 0;
+        Matrix transform = MatrixTranslate((x - center) * instance_spacing, (y - center) * instance_spacing, (z - center) * instance_spacing);
+        instanceMin = Vector3Min(instanceMin, {transform.m12, transform.m13, transform.m14});
+        instanceMax = Vector3Max(instanceMax, {transform.m12, transform.m13, transform.m14});
+        float16 m = MatrixToFloatV(transform);
+        float* dst = &data[i * INSTANCE_FLOATS];
+        memcpy(dst, m.v, sizeof(m.v));
+        float denom = side > 1 ? (float)(side - 1) : 1.0f;
+        dst[16] = x / denom;
+        dst[17] = y / denom;
+        dst[18] = z / denom;
+        dst[19] = n > 1 ? i / (float)(n - 1) : 0.0f;
+    }
+    if (instanceVbo == 0) {
+        glGenBuffers(1, &instanceVbo);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    MemoryTracker::Track(MEMORY_INSTANCES, num, data.size() * sizeof(float), num);
 }
 
+void PixelShader::BindInstanceAttributes() {
+    const GLsizei stride = INSTANCE_FLOATS * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    for (int c = 0; c < 4; c++) {
+        glEnableVertexAttribArray(INSTANCE_TRANSFORM_LOCATION + c);
+        glVertexAttribPointer(INSTANCE_TRANSFORM_LOCATION + c, 4, GL_FLOAT, GL_FALSE, stride, (void*)(c * 4 * sizeof(float)));
+        glVertexAttribDivisor(INSTANCE_TRANSFORM_LOCATION + c, 1);
+    }
+    glEnableVertexAttribArray(INSTANCE_PARAM_LOCATION);
+    glVertexAttribPointer(INSTANCE_PARAM_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (void*)(16 * sizeof(float)));
+    glVertexAttribDivisor(INSTANCE_PARAM_LOCATION, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
 bool PixelShader::InputTextureFields(std::string str) {
     if (image_uniform_buffers.count(str) < 1) {
@@ -811,6 +1451,10 @@ bool PixelShader::InputTextureFields(std::string str) {
     ImGui::PushID(str.c_str());
     ImGui::InputTextWithHint(str.c_str(), "path to image", buf, IMAGE_NAME_BUFFER_LENGTH);
     bool isSet = false;
+    if (FileIndex::DrawSuggestions(buf, IMAGE_NAME_BUFFER_LENGTH, FILE_INDEX_IMAGE)) {
+        SetUniform(str, SAMPLER2D, buf);
+        isSet = true;
+    }
     static std::map<std::string, bool> browse_returned;
     if (browse_returned.count(str) < 1) {
         browse_returned.insert(std::make_pair(str, false));
@@ -828,6 +1472,12 @@ bool PixelShader::InputTextureFields(std::string str) {
         SetUniform(str, SAMPLER2D, buf);
         isSet = true;
     }
+    AnimatedTexture* anim = GetAnimatedTexture(tex);
+    if (anim != nullptr) {
+        AnimatedTexture::Stats stats = anim->GetStats();
+        ImGui::Text("%d frames (%dx%d), %s | decoded %u, dropped %u", stats.frame_count, stats.width, stats.height,
+            anim->fps > 0 ? TextFormat("%.2f fps", anim->fps) : "synced to frame", stats.decoded_frames, stats.dropped_frames);
+    }
     InputTextureOptions(tex);
     if (ImGui::Button("Set RT Size from Texture")) {
         if (tex.width > 0 && tex.height > 0) {
@@ -986,6 +1636,7 @@ void PixelShader::DrawGUI(float dt) {
     }
     ImGui::SameLine();
     ImGui::Checkbox("Save Sequence", &saving_sequence);
+
     ImGui::SameLine();
     if (ImGui::Checkbox("Save Gif", &saving_gif)) {
         if (saving_gif) {
@@ -997,6 +1648,7 @@ void PixelShader::DrawGUI(float dt) {
             // finished recording
             TraceLog(LOG_INFO, "Finishing recording gif...");
             MsfGifResult result = msf_gif_end(&gifState);
+            MemoryTracker::Untrack(MEMORY_GIF, num);
             if (result.data != nullptr) {
                 std::ofstream fd(saving_filename, std::ios::out | std::ios::binary);
                 if (fd.is_open()) {
@@ -1011,10 +1663,48 @@ void PixelShader::DrawGUI(float dt) {
             }
         }
     }
-    int size[2] = {rt_width, rt_height};
-    if (ImGui::InputInt2("Render Texture Size", size)) {
-        if (size[0] != rt_width || size[1] != rt_height) {
-            SetRTSize(size[0], size[1]);
+    ImGui::InputTextWithHint("Sweep Job", "path to sweep job (json)", sweep_job, sizeof(sweep_job));
+    ImGui::SameLine();
+    if (ImGui::Button("Browse##sweep")) {
+        fileDialogManager.openIfNotAlready("BrowseForSweepJob " + name, "Select a Sweep Job", BrowseFilenameCB(sweep_job, nullptr));
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Run Sweep") && sweep_job[0] != 0) {
+        requested_sweep = true;
+    }
+    bool publishing = frame_ring != nullptr;
+#ifdef WIN32
+    // SharedMemory is only implemented on Linux and macOS
+    ImGui::BeginDisabled();
+#endif
+    if (ImGui::Checkbox("Publish Frames", &publishing)) {
+        PublishFrames(publishing);
+    }
+#ifdef WIN32
+    ImGui::EndDisabled();
+    ImGui::SetItemTooltip("Publishing frames is only available on Linux and macOS");
+#endif
+    if (frame_ring != nullptr) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("shared memory %s", frame_ring->name.c_str());
+    }
+    ImGui::SetNextItemWidth(ImGui::CalcItemWidth() / 2);
+    if (ImGui::InputInt("Render Rate (Hz)", &render_rate, 10, 60) && render_rate < 0) {
+        render_rate = 0;
+    }
+    ImGui::SetItemTooltip("0 renders at the default rate from the Options window");
+    ImGui::SameLine();
+    ImGui::TextDisabled("%.0f Hz, %llu frames skipped", clock.rate, (unsigned long long)clock.dropped);
+    // the size is applied once editing it is done, not for every digit typed
+    if (!size_editing) {
+        size_edit[0] = rt_width;
+        size_edit[1] = rt_height;
+    }
+    ImGui::InputInt2("Render Texture Size", size_edit);
+    size_editing = ImGui::IsItemActive();
+    if (ImGui::IsItemDeactivatedAfterEdit() && size_edit[0] > 0 && size_edit[1] > 0) {
+        if (size_edit[0] != rt_width || size_edit[1] != rt_height) {
+            SetRTSize(size_edit[0], size_edit[1]);
         }
     }
     // InputTextureOptions(renderTexture.texture);
@@ -1043,16 +1733,74 @@ void PixelShader::DrawGUI(float dt) {
             LoadModel(modelFilebuf);
             browse_returned = false;
         }
+        if (modelPending.size() > 0) {
+            ImGui::SameLine();
+            ImGui::Text("Loading %s...", modelPending.c_str());
+        }
+        const char* layouts[] = {"Single", "Line", "Grid", "Cube"};
+        instances_dirty |= ImGui::InputInt("Instances", &instance_count);
+        instances_dirty |= ImGui::Combo("Instance Layout", &instance_layout, layouts, IM_ARRAYSIZE(layouts));
+        instances_dirty |= ImGui::InputFloat("Instance Spacing", &instance_spacing);
+        if (instance_count < 1) instance_count = 1;
+        ImGui::Checkbox("Frustum Culling", &culling);
+        ImGui::SameLine();
+        ImGui::Text("%d/%d meshes drawn, %d boxes tested, %d BVH nodes, %d triangles",
+            cullStats.visible, cullStats.total, cullStats.boxes_tested, cullStats.nodes_visited, cullStats.triangles);
     }
     ImGui::End();
 
     ImGui::Begin((name + " Uniforms").c_str(), &is_active);
     focused |= ImGui::IsWindowFocused();
+    for (auto& key : variant_keys) {
+        auto it = variant_selection.find(key.name);
+        std::string value = key.values[0];
+        if (it != variant_selection.end() && std::find(key.values.begin(), key.values.end(), it->second) != key.values.end()) {
+            value = it->second;
+        }
+        if (key.values.size() == 2 && key.values[0] == "0" && key.values[1] == "1") {
+            bool on = value == "1";
+            if (ImGui::Checkbox(key.name.c_str(), &on)) {
+                SelectVariant(key.name, on ? "1" : "0");
+            }
+        } else if (ImGui::BeginCombo(key.name.c_str(), value.c_str())) {
+            for (auto& v : key.values) {
+                if (ImGui::Selectable(v.c_str(), v == value)) {
+                    SelectVariant(key.name, v);
+                }
+            }
+            ImGui::EndCombo();
+        }
+    }
+    if (variant_keys.size() > 0 && ImGui::Button("Precompile Variants")) {
+        PrecompileVariants();
+    }
+    // ticked uniforms are turned into constants, so the driver can fold them into the code
+    if (ImGui::Button("Bake Selected")) {
+        Bake();
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(baked.empty() && bake_values.empty());
+    if (ImGui::Button("Revert to Tweakable")) {
+        RevertBake();
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::TextDisabled("%d baked, %d compiled program(s)%s", (int)baked.size(), (int)programs.size(),
+        compiling_key.empty() ? "" : ", compiling...");
     int loc_count = 0;
     for (auto p : shader_locs) {
         auto v = p.second;
         Uniform* uniform = nullptr;
         ImGui::PushID(loc_count++);
+        if (v.second<SAMPLER2D && p.first != "time" && p.first != "dt" && p.first != "frame") {
+            bool selected = bake_selection.count(p.first) > 0;
+            if (ImGui::Checkbox("##bake", &selected)) {
+                if (selected) bake_selection.insert(p.first);
+                else bake_selection.erase(p.first);
+            }
+            ImGui::SetItemTooltip("Bake into the shader");
+            ImGui::SameLine();
+        }
         if (v.second<SAMPLER2D) {
             if (other_uniform_buffers.count(p.first) < 1) {
                 other_uniform_buffers.insert(std::make_pair(p.first, Uniform{0}));
@@ -1137,6 +1885,17 @@ void PixelShader::DrawGUI(float dt) {
         }
         ImGui::PopID();
     }
+    for (auto& b : baked) {
+        ImGui::PushID(loc_count++);
+        bool selected = bake_selection.count(b.name) > 0;
+        if (ImGui::Checkbox("##bake", &selected)) {
+            if (selected) bake_selection.insert(b.name);
+            else bake_selection.erase(b.name);
+        }
+        ImGui::SameLine();
+        ImGui::TextDisabled("%s = %s (baked)", b.name.c_str(), UniformLiteral(b.type, b.value).c_str());
+        ImGui::PopID();
+    }
     ImGui::End();
     UpdateCamera(dt);
     DrawTextEditor();
@@ -1174,6 +1933,7 @@ void PixelShader::DrawTextEditor() {
                 fd.write(textToSave.c_str(), textToSave.length() - 1);
                 fd.close();
             }
+            unsaved = false;
             requested_reload = true;
         }
         if (ImGui::BeginMenu("Edit"))
@@ -1201,6 +1961,10 @@ void PixelShader::DrawTextEditor() {
 
             ImGui::Separator();
 
+            ImGui::MenuItem("Compile while typing", nullptr, &live_compile);
+
+            ImGui::Separator();
+
             if (ImGui::MenuItem("Select all", nullptr, nullptr))
                 editor.SetSelection(TextEditor::Coordinates(), TextEditor::Coordinates(editor.GetTotalLines(), 0));
 
@@ -1220,13 +1984,23 @@ void PixelShader::DrawTextEditor() {
         ImGui::EndMenuBar();
     }
 
-    ImGui::Text("%6d/%-6d %6d lines  | %s | %s | %s | %s", cpos.mLine + 1, cpos.mColumn + 1, editor.GetTotalLines(),
+    ImGui::Text("%6d/%-6d %6d lines  | %s | %s | %s | %s | %s", cpos.mLine + 1, cpos.mColumn + 1, editor.GetTotalLines(),
         editor.IsOverwrite() ? "Ovr" : "Ins",
         editor.CanUndo() ? "*" : " ",
-        editor.GetLanguageDefinition().mName.c_str(), filename);
+        editor.GetLanguageDefinition().mName.c_str(), filename, compile_status.c_str());
 
     editor.Render("TextEditor");
     ImGui::End();
+    if (editor.IsTextChanged()) {
+        unsaved = true;
+        edit_time = GetTime();
+        compile_pending = true;
+    }
+    if (live_compile && compile_pending && GetTime() - edit_time >= LIVE_COMPILE_DELAY) {
+        compile_pending = false;
+        compile_status = "compiling...";
+        SubmitCompile();
+    }
     if (requested_reload) {
         Reload();
         requested_reload = false;
@@ -1286,6 +2060,7 @@ void PixelShader::SetUniform(std::string name, ShaderUniformType type, void* val
                 strncpy(buf.first, (char*)value, IMAGE_NAME_BUFFER_LENGTH-1);
                 buf.first[IMAGE_NAME_BUFFER_LENGTH-1] = 0;
                 buf.second = LoadTextureFromString(buf.first);
+                MemoryTracker::SetOwner(MEMORY_TEXTURES, buf.second.id, num);
                 // SetShaderValueTexture(pixelShader, v.first, buf.second);
             }
             break;
@@ -1294,132 +2069,144 @@ void PixelShader::SetUniform(std::string name, ShaderUniformType type, void* val
     }
 }
 
-void PixelShader::LoadUniforms(nlohmann::json json) {
-    if (!json.is_object()) return;
+std::vector<SavedUniform> UniformsFromJson(const nlohmann::json& json) {
+    std::vector<SavedUniform> uniforms;
+    if (!json.is_object()) return uniforms;
     for (auto p : json.items()) {
-        auto j = p.value();
-        if (j.contains("t") && j["t"].is_number()) {
-            switch (j["t"].get<int>()) {
-                case INT:
-                    if (j["v"].is_number()) {
-                        int ival = j["v"].get<int>();
-                        SetUniform(p.key(), INT, &ival);
-                    }
-                    break;
-                case FLOAT:
-                case SLIDER:
-                    if (j["v"].is_number()) {
-                        float fval = j["v"].get<float>();
-                        SetUniform(p.key(), FLOAT, &fval);
-                    }
-                    break;
-                case VEC2:
-                case SLIDER2:
-                    if (j["v"].is_array()) {
-                        float fval[2];
-                        for (int i=0; i<2; i++) {
-                            if (j["v"].size() >= i && j["v"][i].is_number()) {
-                                fval[i] = j["v"][i].get<float>();
-                            }
-                        }
-                        SetUniform(p.key(), VEC2, &fval);
-                    }
-                    break;
-                case VEC3:
-                case COLOR3:
-                case SLIDER3:
-                    if (j["v"].is_array()) {
-                        float fval[3];
-                        for (int i=0; i<3; i++) {
-                            if (j["v"].size() >= i && j["v"][i].is_number()) {
-                                fval[i] = j["v"][i].get<float>();
-                            }
-                        }
-                        SetUniform(p.key(), VEC3, &fval);
-                    }
-                    break;
-                case VEC4:
-                case COLOR4:
-                case SLIDER4:
-                    if (j["v"].is_array()) {
-                        float fval[4];
-                        for (int i=0; i<4; i++) {
-                            if (j["v"].size() >= i && j["v"][i].is_number()) {
-                                fval[i] = j["v"][i].get<float>();
-                            }
-                        }
-                        SetUniform(p.key(), VEC4, &fval);
-                    }
-                    break;
-                case SAMPLER2D:
-                    if (j["v"].is_string()) {
-                        std::string tex = j["v"].get<std::string>();
-                        SetUniform(p.key(), SAMPLER2D, (void*)tex.c_str());
-                    }
-                    break;
-                default:
-                    break;
+        auto& j = p.value();
+        if (!j.is_object() || !j.contains("t") || !j["t"].is_number_integer() || !j.contains("v")) {
+            continue;
+        }
+        auto& v = j["v"];
+        SavedUniform u = {p.key(), (ShaderUniformType)j["t"].get<int>()};
+        u.value = {0};
+        int n = 0;
+        switch (u.type) {
+            case INT:
+                if (!v.is_number()) continue;
+                u.value.i = v.get<int>();
+                break;
+            case FLOAT:
+            case SLIDER:
+                if (!v.is_number()) continue;
+                u.value.f = v.get<float>();
+                break;
+            case VEC2:
+            case SLIDER2:
+                n = 2;
+                break;
+            case VEC3:
+            case COLOR3:
+            case SLIDER3:
+                n = 3;
+                break;
+            case VEC4:
+            case COLOR4:
+            case SLIDER4:
+                n = 4;
+                break;
+            case SAMPLER2D:
+                if (!v.is_string()) continue;
+                u.image = v.get<std::string>();
+                break;
+            default:
+                continue;
+        }
+        if (n > 0) {
+            if (!v.is_array()) continue;
+            for (int i=0; i<n && i<(int)v.size(); i++) {
+                if (v[i].is_number()) {
+                    u.value.v[i] = v[i].get<float>();
+                }
             }
         }
+        u.value.isSet = u.type != SAMPLER2D;
+        uniforms.push_back(u);
     }
+    return uniforms;
 }
 
-nlohmann::json PixelShader::DumpUniforms() {
-    nlohmann::json json;
-    for (auto l : shader_locs) {
-        std::string key = l.first;
+void PixelShader::ApplyUniforms(const std::vector<SavedUniform>& uniforms) {
+    for (auto& u : uniforms) {
+        if (u.type == SAMPLER2D) {
+            SetUniform(u.name, SAMPLER2D, (void*)u.image.c_str());
+        } else if (u.value.isSet) {
+            Uniform value = u.value;
+            SetUniform(u.name, u.type, &value);
+        }
+    }
+}
+
+void PixelShader::LoadUniforms(nlohmann::json json) {
+    ApplyUniforms(UniformsFromJson(json));
+}
+
+std::vector<SavedUniform> PixelShader::SnapshotUniforms() {
+    std::vector<SavedUniform> uniforms;
+    for (auto& l : shader_locs) {
+        const std::string& key = l.first;
         ShaderUniformType type = l.second.second;
-        bool should_include = true;
-        nlohmann::json j = {{"t", type}};
+        SavedUniform u = {key, type};
+        u.value = {0};
         if (type == SAMPLER2D) {
             if (key == "selfTexture") {
                 continue;
             }
-            // printf("Dumping Sampler2D\n");
-            if (image_uniform_buffers.count(key) < 1) {
-                should_include = false;
-                // printf("Sampler2D Value not found\n");
-            } else if (strlen(image_uniform_buffers[key].first) > 0) {
-                j["v"] = std::string(image_uniform_buffers[key].first);
-                // printf("Sampler2D Value: %s\n", image_uniform_buffers[key].first);
-            } else {
-                should_include = false;
-                // printf("Sampler2D Value empty\n");
+            auto it = image_uniform_buffers.find(key);
+            if (it == image_uniform_buffers.end() || strlen(it->second.first) < 1) {
+                continue;
             }
-        } else if (other_uniform_buffers.count(key) > 0) {
-            Uniform uniform = other_uniform_buffers[key];
-            if (uniform.isSet) {
-                switch (type) {
-                case INT:
-                    j["v"] = uniform.i;
-                    break;
-                case FLOAT:
-                case SLIDER:
-                    j["v"] = uniform.f;
-                    break;
-                case VEC2:
-                case SLIDER2:
-                    j["v"] = nlohmann::json::array({uniform.v[0], uniform.v[1]});
-                    break;
-                case VEC3:
-                case COLOR3:
-                case SLIDER3:
-                    j["v"] = nlohmann::json::array({uniform.v[0], uniform.v[1], uniform.v[2]});
-                    break;
-                case VEC4:
-                case COLOR4:
-                case SLIDER4:
-                    j["v"] = nlohmann::json::array({uniform.v[0], uniform.v[1], uniform.v[2], uniform.v[3]});
-                    break;
-                default:
-                    break;
-                }
+            u.image = it->second.first;
+        } else {
+            auto it = other_uniform_buffers.find(key);
+            if (it != other_uniform_buffers.end()) {
+                u.value = it->second;
             }
         }
-        if (should_include) {
-            json[key] = j;
+        uniforms.push_back(u);
+    }
+    uniforms.insert(uniforms.end(), baked.begin(), baked.end());
+    return uniforms;
+}
+
+nlohmann::json UniformsToJson(const std::vector<SavedUniform>& uniforms) {
+    nlohmann::json json;
+    for (auto& u : uniforms) {
+        nlohmann::json j = {{"t", u.type}};
+        if (u.type == SAMPLER2D) {
+            j["v"] = u.image;
+        } else if (u.value.isSet) {
+            switch (u.type) {
+            case INT:
+                j["v"] = u.value.i;
+                break;
+            case FLOAT:
+            case SLIDER:
+                j["v"] = u.value.f;
+                break;
+            case VEC2:
+            case SLIDER2:
+                j["v"] = nlohmann::json::array({u.value.v[0], u.value.v[1]});
+                break;
+            case VEC3:
+            case COLOR3:
+            case SLIDER3:
+                j["v"] = nlohmann::json::array({u.value.v[0], u.value.v[1], u.value.v[2]});
+                break;
+            case VEC4:
+            case COLOR4:
+            case SLIDER4:
+                j["v"] = nlohmann::json::array({u.value.v[0], u.value.v[1], u.value.v[2], u.value.v[3]});
+                break;
+            default:
+                break;
+            }
         }
+        json[u.name] = j;
     }
-    // printf("%s\n", json.dump().c_str());
     return json;
 }
+
+nlohmann::json PixelShader::DumpUniforms() {
+    return UniformsToJson(SnapshotUniforms());
+}
@@ -1,10 +1,17 @@
 #pragma once
 
 #include "ImGuiColorTextEdit/TextEditor.h"
+#include "Culling.hpp"
+#include "FrameClock.hpp"
+#include "FrameRing.hpp"
+#include "ShaderPreprocessor.hpp"
 #include "external/msf_gif.h"
 #include "nlohmann/json.hpp"
 #include <cstring>
+#include <deque>
+#include <filesystem>
 #include <map>
+#include <set>
 #include <string>
 
 #include <raylib.h>
@@ -13,12 +20,14 @@
 #include <external/glad.h>
 
 extern const char* vertex_shader_code_default;
+extern const char* vertex_shader_code_model;
 
 typedef enum {
     NONE = 0,
     TEXTURE,
     MODEL,
 } ShaderDrawType;
+ShaderDrawType DetectDrawType(const char* code, size_t len);
 
 typedef enum {
     UNKNOWN = 0,
@@ -60,7 +69,32 @@ typedef struct {
 } Uniform;
 
 
+// uniform value as saved to a workspace, copied out so it can be serialized off the render thread
+typedef struct {
+    std::string name;
+    ShaderUniformType type;
+    Uniform value;
+    std::string image;
+} SavedUniform;
+
+nlohmann::json UniformsToJson(const std::vector<SavedUniform>& uniforms);
+std::vector<SavedUniform> UniformsFromJson(const nlohmann::json& json);
+
 #define IMAGE_NAME_BUFFER_LENGTH 512
+// compiled programs kept per shader for variants and baked uniforms, see PixelShader::SwitchProgram
+#define SHADER_PROGRAM_CACHE_SIZE 32
+
+// model shader vertex attribute locations for per-instance data (mat4 transform + vec4 parameter)
+#define INSTANCE_TRANSFORM_LOCATION 6
+#define INSTANCE_PARAM_LOCATION 10
+#define INSTANCE_FLOATS 20
+
+typedef enum {
+    INSTANCE_LAYOUT_SINGLE = 0,
+    INSTANCE_LAYOUT_LINE,
+    INSTANCE_LAYOUT_GRID,
+    INSTANCE_LAYOUT_CUBE,
+} InstanceLayout;
 
 void DrawEmptyTriangleStrip();
 Texture2D LoadTextureFromString(const char* str);
@@ -78,7 +112,11 @@ class PixelShader {
     std::string saving_filename;
     MsfGifState gifState;
     int rt_width, rt_height;
-    int num;
+    // "Render Texture Size" while it is being edited
+    int size_edit[2] = {0, 0};
+    bool size_editing = false;
+    // assigned before Load, which cancels the compiles queued under this number
+    int num = -1;
     ShaderDrawType drawType;
     unsigned int sampler_count = 0;
     unsigned int frame_counter = 0;
@@ -86,6 +124,7 @@ class PixelShader {
     bool is_active, saving_sequence, saving_single, saving_gif;
     bool requested_clone : 1;
     bool requested_reference : 1;
+    bool requested_sweep : 1;
     bool requested_reload : 1;
     bool focused : 1;
     bool controlling_camera : 1;
@@ -93,10 +132,55 @@ class PixelShader {
     const char* filename;
     char image_input[IMAGE_NAME_BUFFER_LENGTH] = {0};
     char image_output[IMAGE_NAME_BUFFER_LENGTH] = {0};
+    // parameter sweep job run by the "Run Sweep" button, see Sweep
+    char sweep_job[IMAGE_NAME_BUFFER_LENGTH] = {0};
+    // frames rendered per second, 0 for the default rate, and the clock main paces Update with
+    int render_rate = 0;
+    FrameClock clock;
+    // shared memory output of every frame, see FrameRing
+    FrameRing* frame_ring = nullptr;
     TextEditor editor;
     Rectangle outputArea;
     Model model = {0};
+    std::string modelPath, modelPending;
+    unsigned int instanceVbo = 0;
+    int instance_count = 1;
+    int instance_layout = INSTANCE_LAYOUT_SINGLE;
+    float instance_spacing = 2.5f;
+    bool instances_dirty = true;
+    Vector3 instanceMin = {0}, instanceMax = {0};
+    bool culling = true;
+    CullStats cullStats = {0};
+    std::vector<int> visibleMeshes;
     char* modelFilebuf = nullptr;
+    // background compile of the editor buffer, see ShaderCompiler
+    bool live_compile = true;
+    bool compile_pending = false;
+    double edit_time = 0;
+    // the editor buffer with its includes expanded, kept to map compile errors back to the buffer
+    ShaderPreprocessor::Result compile_source;
+    std::string compile_status;
+    // files pulled in by #include, a change to any of them recompiles the shader
+    std::vector<std::string> includes;
+    // expanded source before variants and baked uniforms are applied, and the program source of the editor compile
+    std::string source_code, compile_program;
+    // "//#variant" keys declared in the source and the value picked for each
+    std::vector<ShaderPreprocessor::VariantKey> variant_keys;
+    std::map<std::string, std::string> variant_selection;
+    // uniforms picked to be baked into the program as constants, the ones baked into the running program,
+    // and the ones wanted (the program is switched once it is compiled)
+    std::set<std::string> bake_selection;
+    std::vector<SavedUniform> baked, bake_values;
+    // compiled programs by their source, including the running one
+    std::map<std::string, Shader> programs;
+    std::string program_key;
+    // the program wanted, the one on the compiler, and ones to compile while it is idle
+    std::string pending_key, compiling_key;
+    std::deque<std::string> precompile;
+    ShaderDrawType compile_type = ShaderDrawType::NONE;
+    // for hot reload, see FileWatcher: the editor has changes that weren't saved, and the file time when loaded
+    bool unsaved = false;
+    std::filesystem::file_time_type file_time;
     Camera3D camera = {
         {0, 0, -4},
         {0, 0, -3},
@@ -109,6 +193,7 @@ class PixelShader {
         is_active = true;
         requested_clone = false;
         requested_reference = false;
+        requested_sweep = false;
         saving_sequence = false;
         saving_single = false;
         saving_gif = false;
@@ -125,13 +210,28 @@ class PixelShader {
     PixelShader(PixelShader& other) : PixelShader(&other) {}
     PixelShader(const char* fname);
     PixelShader(const char* fname, int id);
+    // code is the contents of fname, compiled a program already built from it (see ResourceLoader)
+    PixelShader(const char* fname, int id, const std::string& code, Shader compiled);
     bool operator==(PixelShader ps) {
         return ps.num == num;
     }
     bool IsReady();
+    // Pick up models the cache (re)loaded and finished background compiles. Call every loop iteration,
+    // right after ModelCache::Poll, whether or not the UI is drawn, so Update never draws a retired model.
+    void Poll();
     void Update(float dt);
+    // Draw one frame into the viewport (x, y, width, height) of the bound render texture, without clearing it.
+    void Render(float dt, int x, int y, int width, int height);
     protected:
     bool Load(const char* filename);
+    bool Load(const char* filename, const std::string& code, Shader compiled);
+    void UseShader(Shader newPixelShader, const char* fragment_code, size_t len, const char* vertex_code);
+    std::string ProgramSource(const std::map<std::string, std::string>& selection, const std::vector<SavedUniform>& bake);
+    void SwitchProgram();
+    void CompileNext();
+    void UseProgram(const std::string& key);
+    void RestoreBaked();
+    void ClearPrograms();
     public:
     bool New(const char* filename);
     void Unload();
@@ -139,13 +239,35 @@ class PixelShader {
     void Setup(int width, int height);
     void SetRTSize(int width, int height);
     void SetClearColor(int r, int g, int b, int a);
+    // Publish every frame to the shared memory ring named "/pstb-<pid>-s<num>", or stop.
+    void PublishFrames(bool enable);
     void LoadModel(std::string fname);
+    void PollModel();
+    void UpdateInstances();
+    void BindInstanceAttributes();
     bool InputTextureFields(std::string str);
     void UpdateCamera(float dt);
     void DrawGUI(float dt);
     void DrawTextEditor();
+    void SubmitCompile();
+    void PollCompile();
+    // Pick a value for a variant key, switching programs as soon as that variant is compiled.
+    void SelectVariant(const std::string& key, const std::string& value);
+    // Compile every combination of variant values in the background.
+    void PrecompileVariants();
+    // Compile the shader with the selected uniforms replaced by constants of their current values and swap it in.
+    void Bake();
+    // Go back to the program with every uniform tweakable.
+    void RevertBake();
+    void PollPrograms();
+    // add the files this shader uses to paths
+    void WatchedFiles(std::vector<std::string>& paths);
+    // reload whatever uses path, after it changed on disk
+    void FileChanged(const std::string& path);
     void SetUniform(std::string name, ShaderUniformType type, void* value);
     void LoadUniforms(nlohmann::json json);
+    void ApplyUniforms(const std::vector<SavedUniform>& uniforms);
+    std::vector<SavedUniform> SnapshotUniforms();
     nlohmann::json DumpUniforms();
 };
 
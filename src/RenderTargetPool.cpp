@@ -0,0 +1,125 @@
+#include <deque>
+#include <string>
+#include <map>
+#include <utility>
+
+#include <raylib.h>
+#include <rlgl.h>
+
+#include "RenderTargetPool.hpp"
+#include "MemoryTracker.hpp"
+
+namespace RenderTargetPool {
+
+typedef std::pair<std::pair<int, int>, int> Key;
+
+// idle targets by size and format, and all of them in the order they were released
+std::map<Key, std::deque<RenderTexture2D>> idle;
+std::deque<std::pair<Key, unsigned int>> released;
+Stats stats = {0};
+
+size_t Bytes(int width, int height) {
+    // RGBA8 color plus a 24 bit depth buffer, which drivers store in 32 bits
+    return (size_t)width * height * 8;
+}
+
+Key KeyOf(const RenderTexture2D& target) {
+    return {{target.texture.width, target.texture.height}, target.texture.format};
+}
+
+void Unload(const Key& key, unsigned int id) {
+    auto it = idle.find(key);
+    if (it == idle.end()) {
+        return;
+    }
+    for (auto t = it->second.begin(); t != it->second.end(); t++) {
+        if (t->id == id) {
+            MemoryTracker::Untrack(MEMORY_RENDER_TARGETS, t->id);
+            UnloadRenderTexture(*t);
+            it->second.erase(t);
+            stats.idle--;
+            stats.idle_bytes -= Bytes(key.first.first, key.first.second);
+            break;
+        }
+    }
+    if (it->second.empty()) {
+        idle.erase(it);
+    }
+}
+
+std::string Label(int width, int height, bool in_use) {
+    return std::to_string(width) + "x" + std::to_string(height) + (in_use ? "" : " (idle)");
+}
+
+RenderTexture2D Acquire(int width, int height, int owner) {
+    Key key = {{width, height}, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+    auto it = idle.find(key);
+    if (it == idle.end()) {
+        RenderTexture2D target = LoadRenderTexture(width, height);
+        if (IsRenderTextureReady(target)) {
+            stats.misses++;
+            stats.in_use++;
+            stats.in_use_bytes += Bytes(width, height);
+            MemoryTracker::Track(MEMORY_RENDER_TARGETS, target.id, Bytes(width, height), owner, Label(width, height, true));
+        }
+        return target;
+    }
+    RenderTexture2D target = it->second.back();
+    it->second.pop_back();
+    if (it->second.empty()) {
+        idle.erase(it);
+    }
+    for (auto r = released.begin(); r != released.end(); r++) {
+        if (r->second == target.id) {
+            released.erase(r);
+            break;
+        }
+    }
+    stats.hits++;
+    stats.idle--;
+    stats.idle_bytes -= Bytes(width, height);
+    stats.in_use++;
+    stats.in_use_bytes += Bytes(width, height);
+    MemoryTracker::Track(MEMORY_RENDER_TARGETS, target.id, Bytes(width, height), owner, Label(width, height, true));
+    // whatever the last user drew is still in it
+    rlDrawRenderBatchActive();
+    rlEnableFramebuffer(target.id);
+    rlClearColor(0, 0, 0, 0);
+    rlClearScreenBuffers();
+    rlDisableFramebuffer();
+    return target;
+}
+
+void Release(RenderTexture2D target) {
+    if (target.id == 0) {
+        return;
+    }
+    Key key = KeyOf(target);
+    size_t bytes = Bytes(target.texture.width, target.texture.height);
+    stats.in_use--;
+    stats.in_use_bytes -= bytes;
+    idle[key].push_back(target);
+    MemoryTracker::Track(MEMORY_RENDER_TARGETS, target.id, bytes, MEMORY_NO_OWNER, Label(target.texture.width, target.texture.height, false));
+    released.push_back({key, target.id});
+    stats.idle++;
+    stats.idle_bytes += bytes;
+    while (stats.idle_bytes > RENDER_TARGET_POOL_MAX_IDLE && !released.empty()) {
+        auto oldest = released.front();
+        released.pop_front();
+        Unload(oldest.first, oldest.second);
+    }
+}
+
+void Trim() {
+    while (!released.empty()) {
+        auto oldest = released.front();
+        released.pop_front();
+        Unload(oldest.first, oldest.second);
+    }
+}
+
+Stats GetStats() {
+    return stats;
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <raylib.h>
+
+// released render targets past this many bytes are unloaded, oldest first
+#define RENDER_TARGET_POOL_MAX_IDLE (256u << 20)
+
+// Recycles render textures (framebuffer, color texture and depth buffer) so resizing a shader back to a size
+// it had, cloning one, or loading one after closing another reuses targets instead of allocating new ones.
+// Released targets are kept by size and format until the idle ones outgrow RENDER_TARGET_POOL_MAX_IDLE.
+// Render thread only.
+namespace RenderTargetPool {
+    typedef struct {
+        uint64_t hits, misses;
+        int in_use, idle;
+        // estimated GPU memory of the targets handed out and of the ones waiting to be reused
+        size_t in_use_bytes, idle_bytes;
+    } Stats;
+
+    // A cleared RGBA8 render texture with a depth buffer, like LoadRenderTexture.
+    // Call outside of any texture mode. owner is the shader it is for, see MemoryTracker.
+    RenderTexture2D Acquire(int width, int height, int owner = -1);
+    // Give back a target from Acquire, an empty target is ignored.
+    void Release(RenderTexture2D target);
+    // Unload every idle target.
+    void Trim();
+    Stats GetStats();
+}
@@ -0,0 +1,218 @@
+#include <condition_variable>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "PixelShader.hpp"
+#include "ResourceLoader.hpp"
+#include "ShaderCompiler.hpp"
+#include "ShaderPreprocessor.hpp"
+#include "ThreadPool.hpp"
+
+namespace ResourceLoader {
+
+typedef enum {
+    SHADER_READING = 0,
+    SHADER_COMPILING,
+    SHADER_READY,
+    SHADER_FAILED,
+} ShaderState;
+
+struct ShaderJob {
+    ShaderState state;
+    std::string code;
+    Shader shader;
+};
+
+struct ImageJob {
+    int refs;
+    bool done;
+    Image image;
+};
+
+std::unique_ptr<ThreadPool> pool;
+std::map<int, ShaderJob> shaders;
+std::map<std::string, ImageJob> images;
+std::mutex mutex;
+std::condition_variable cv;
+
+ThreadPool& Pool() {
+    if (!pool) {
+        pool.reset(new ThreadPool());
+    }
+    return *pool;
+}
+
+void ReadShader(int id, std::string path) {
+    std::ifstream fd(path, std::ios::in | std::ios::binary);
+    std::string code;
+    if (fd.is_open()) {
+        code.assign(std::istreambuf_iterator<char>(fd), std::istreambuf_iterator<char>());
+    }
+    ShaderPreprocessor::Result source;
+    if (!code.empty() && !ShaderPreprocessor::Process(path, code, source)) {
+        // left to PixelShader::Load, which reports the error
+        code.clear();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = shaders.find(id);
+    if (it == shaders.end()) {
+        return;
+    }
+    if (code.empty()) {
+        it->second.state = SHADER_FAILED;
+        return;
+    }
+    // submitted with the lock held so a cancel can't slip in between, a new shader starts with the default variants
+    std::string program = ShaderPreprocessor::ApplyVariants(source.code, {});
+    const char* vertex_code = DetectDrawType(program.c_str(), program.size()) == ShaderDrawType::MODEL ? vertex_shader_code_model : vertex_shader_code_default;
+    ShaderCompiler::Submit(id, vertex_code, program);
+    it->second.code = std::move(code);
+    it->second.state = SHADER_COMPILING;
+}
+
+void DecodeImage(std::string path) {
+    Image image = LoadImage(path.c_str());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = images.find(path);
+        if (it == images.end()) {
+            UnloadImage(image);
+            return;
+        }
+        it->second.image = image;
+        it->second.done = true;
+    }
+    cv.notify_all();
+}
+
+void RequestShader(int id, std::string path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shaders[id] = {SHADER_READING, "", {0}};
+    }
+    Pool().Submit([id, path] { ReadShader(id, path); });
+}
+
+bool IsShaderReady(int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = shaders.find(id);
+    return it == shaders.end() || it->second.state == SHADER_READY || it->second.state == SHADER_FAILED;
+}
+
+bool TakeShader(int id, std::string& code, Shader& shader) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = shaders.find(id);
+    if (it == shaders.end()) {
+        return false;
+    }
+    bool ok = it->second.state == SHADER_READY;
+    if (ok) {
+        code = std::move(it->second.code);
+        shader = it->second.shader;
+    } else if (it->second.state == SHADER_COMPILING) {
+        // not done yet, the caller compiles it again itself
+        ShaderCompiler::Cancel(id);
+    }
+    shaders.erase(it);
+    return ok;
+}
+
+void CancelShader(int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = shaders.find(id);
+    if (it == shaders.end()) {
+        return;
+    }
+    if (it->second.state == SHADER_COMPILING) {
+        ShaderCompiler::Cancel(id);
+    } else if (it->second.state == SHADER_READY && it->second.shader.id != 0) {
+        UnloadShader(it->second.shader);
+    }
+    shaders.erase(it);
+}
+
+void RequestImage(std::string path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = images.find(path);
+        if (it != images.end()) {
+            it->second.refs++;
+            return;
+        }
+        images[path] = {1, false, {0}};
+    }
+    Pool().Submit([path] { DecodeImage(path); });
+}
+
+bool IsImageReady(std::string path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = images.find(path);
+    return it == images.end() || it->second.done;
+}
+
+bool GetImage(std::string path, Image& image) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = images.find(path);
+    if (it == images.end()) {
+        return false;
+    }
+    // map nodes stay put while other images come and go, so the iterator survives the wait
+    cv.wait(lock, [&it] { return it->second.done; });
+    image = it->second.image;
+    return ::IsImageReady(image);
+}
+
+void ReleaseImage(std::string path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = images.find(path);
+    if (it == images.end() || --it->second.refs > 0) {
+        return;
+    }
+    // an image still being decoded is unloaded by DecodeImage when it finds the entry gone
+    if (it->second.done) {
+        UnloadImage(it->second.image);
+    }
+    images.erase(it);
+}
+
+void Poll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& s : shaders) {
+        if (s.second.state != SHADER_COMPILING) {
+            continue;
+        }
+        ShaderCompiler::Result result;
+        if (ShaderCompiler::Poll(s.first, result)) {
+            s.second.shader = result.success ? ShaderCompiler::ShaderFromProgram(result.program) : Shader{0};
+            s.second.state = SHADER_READY;
+        }
+    }
+}
+
+void Shutdown() {
+    if (pool) {
+        pool->Shutdown();
+        pool.reset();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& s : shaders) {
+        if (s.second.state == SHADER_COMPILING) {
+            ShaderCompiler::Cancel(s.first);
+        } else if (s.second.state == SHADER_READY && s.second.shader.id != 0) {
+            UnloadShader(s.second.shader);
+        }
+    }
+    shaders.clear();
+    for (auto& i : images) {
+        if (i.second.done) {
+            UnloadImage(i.second.image);
+        }
+    }
+    images.clear();
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+#include <raylib.h>
+
+// Loads workspace resources ahead of the shaders that use them.
+// File reads and image decodes run on a thread pool, fragment shaders go on to ShaderCompiler as soon as
+// they have been read, so a shader that is loaded later only has to pick up finished results instead of
+// doing every step in sequence on the render thread. Models are already loaded this way by ModelCache.
+namespace ResourceLoader {
+    // Read the fragment shader at path and compile it for the shader with this id.
+    void RequestShader(int id, std::string path);
+    // Whether RequestShader has finished, successfully or not.
+    bool IsShaderReady(int id);
+    // Take the source and program of a finished request. The program is empty (id 0) if it failed to
+    // compile, returns false if the file couldn't be read or nothing was requested.
+    bool TakeShader(int id, std::string& code, Shader& shader);
+    void CancelShader(int id);
+
+    // Decode the image at path, it is kept until every request for it has been released.
+    void RequestImage(std::string path);
+    bool IsImageReady(std::string path);
+    // Get a requested image, waiting for it if it is still being decoded. Valid until it is released.
+    bool GetImage(std::string path, Image& image);
+    void ReleaseImage(std::string path);
+
+    // Collect compiled programs, call once a frame on the render thread.
+    void Poll();
+    void Shutdown();
+}
@@ -0,0 +1,298 @@
+#include <cctype>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <raylib.h>
+#include <rlgl.h>
+#include <external/glad.h>
+#define GLFW_INCLUDE_NONE
+#include <external/glfw/include/GLFW/glfw3.h>
+
+#include "ShaderCompiler.hpp"
+
+namespace ShaderCompiler {
+
+struct Job {
+    unsigned int seq;
+    std::string vertexCode, fragmentCode;
+};
+
+// the attribute names raylib binds to fixed locations before linking (see rlLoadShaderProgram)
+const char* attribute_names[] = {
+    "vertexPosition", "vertexTexCoord", "vertexNormal", "vertexColor", "vertexTangent", "vertexTexCoord2",
+};
+
+std::map<int, Job> queued;
+// sequence number of the newest submission per owner, results of older ones are thrown away
+std::map<int, unsigned int> latest;
+std::map<int, Result> finished;
+std::mutex mutex;
+std::condition_variable cv;
+std::thread worker;
+GLFWwindow* context = nullptr;
+unsigned int next_seq = 1;
+bool stopping = false;
+
+unsigned int CompileStage(GLenum type, const std::string& code, std::string& log) {
+    unsigned int id = glCreateShader(type);
+    const char* src = code.c_str();
+    glShaderSource(id, 1, &src, nullptr);
+    glCompileShader(id);
+    GLint success = 0, length = 0;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+    if (length > 1) {
+        std::string info(length, '\0');
+        glGetShaderInfoLog(id, length, nullptr, &info[0]);
+        info.resize(strlen(info.c_str()));
+        log += info;
+    }
+    if (success == GL_FALSE) {
+        glDeleteShader(id);
+        return 0;
+    }
+    return id;
+}
+
+Result Compile(const Job& job) {
+    Result result = {false, 0};
+    std::string vertexLog;
+    unsigned int vs = CompileStage(GL_VERTEX_SHADER, job.vertexCode, vertexLog);
+    unsigned int fs = CompileStage(GL_FRAGMENT_SHADER, job.fragmentCode, result.log);
+    result.markers = ParseInfoLog(result.log);
+    if (vertexLog.size() > 0) {
+        // the vertex stage is built in, its line numbers mean nothing in the editor
+        result.log += "vertex shader: " + vertexLog;
+    }
+    if (vs != 0 && fs != 0) {
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, vs);
+        glAttachShader(program, fs);
+        for (int i=0; i<(int)(sizeof(attribute_names)/sizeof(attribute_names[0])); i++) {
+            glBindAttribLocation(program, i, attribute_names[i]);
+        }
+        glLinkProgram(program);
+        GLint success = 0, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        if (length > 1) {
+            std::string info(length, '\0');
+            glGetProgramInfoLog(program, length, nullptr, &info[0]);
+            info.resize(strlen(info.c_str()));
+            result.log += info;
+        }
+        glDetachShader(program, vs);
+        glDetachShader(program, fs);
+        if (success == GL_FALSE) {
+            glDeleteProgram(program);
+        } else {
+            result.success = true;
+            result.program = program;
+        }
+    }
+    if (vs != 0) glDeleteShader(vs);
+    if (fs != 0) glDeleteShader(fs);
+    return result;
+}
+
+// runs on whichever thread owns the compile context, with the mutex held on entry and exit
+void RunJob(std::unique_lock<std::mutex>& lock) {
+    auto it = queued.begin();
+    int owner = it->first;
+    Job job = std::move(it->second);
+    queued.erase(it);
+    lock.unlock();
+    Result result = Compile(job);
+    if (context != nullptr) {
+        // the program has to be complete before another context may use it
+        glFinish();
+    }
+    lock.lock();
+    auto l = latest.find(owner);
+    if (l == latest.end() || l->second != job.seq) {
+        if (result.program != 0) glDeleteProgram(result.program);
+        return;
+    }
+    auto f = finished.find(owner);
+    if (f != finished.end() && f->second.program != 0) {
+        glDeleteProgram(f->second.program);
+    }
+    finished[owner] = std::move(result);
+}
+
+void Run() {
+    glfwMakeContextCurrent(context);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [] { return stopping || !queued.empty(); });
+        if (stopping) {
+            break;
+        }
+        RunJob(lock);
+    }
+    lock.unlock();
+    glfwMakeContextCurrent(nullptr);
+}
+
+bool Init() {
+    // window hints are still the ones raylib created its window with, so the contexts are compatible
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_FOCUSED, GLFW_FALSE);
+    context = glfwCreateWindow(1, 1, "ShaderCompiler", nullptr, glfwGetCurrentContext());
+    if (context == nullptr) {
+        TraceLog(LOG_WARNING, "Could not create a shared GL context, shaders will be compiled on the render thread.");
+        return false;
+    }
+    worker = std::thread(Run);
+    return true;
+}
+
+void Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queued.clear();
+        latest.clear();
+        for (auto& f : finished) {
+            if (f.second.program != 0) glDeleteProgram(f.second.program);
+        }
+        finished.clear();
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (context != nullptr) {
+        glfwDestroyWindow(context);
+        context = nullptr;
+    }
+}
+
+void Submit(int owner, std::string vertexCode, std::string fragmentCode) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        unsigned int seq = next_seq++;
+        queued[owner] = {seq, std::move(vertexCode), std::move(fragmentCode)};
+        latest[owner] = seq;
+    }
+    cv.notify_one();
+}
+
+bool Poll(int owner, Result& result) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (context == nullptr && queued.count(owner) > 0) {
+        while (queued.count(owner) > 0) {
+            RunJob(lock);
+        }
+    }
+    auto it = finished.find(owner);
+    if (it == finished.end()) {
+        return false;
+    }
+    result = std::move(it->second);
+    finished.erase(it);
+    return true;
+}
+
+bool IsBusy(int owner) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return latest.count(owner) > 0 && finished.count(owner) == 0;
+}
+
+void Cancel(int owner) {
+    std::lock_guard<std::mutex> lock(mutex);
+    queued.erase(owner);
+    latest.erase(owner);
+    auto it = finished.find(owner);
+    if (it != finished.end()) {
+        if (it->second.program != 0) glDeleteProgram(it->second.program);
+        finished.erase(it);
+    }
+}
+
+Shader ShaderFromProgram(unsigned int program) {
+    Shader shader = {0};
+    shader.id = program;
+    shader.locs = (int*)calloc(RL_MAX_SHADER_LOCATIONS, sizeof(int));
+    for (int i=0; i<RL_MAX_SHADER_LOCATIONS; i++) shader.locs[i] = -1;
+    shader.locs[SHADER_LOC_VERTEX_POSITION] = rlGetLocationAttrib(program, "vertexPosition");
+    shader.locs[SHADER_LOC_VERTEX_TEXCOORD01] = rlGetLocationAttrib(program, "vertexTexCoord");
+    shader.locs[SHADER_LOC_VERTEX_TEXCOORD02] = rlGetLocationAttrib(program, "vertexTexCoord2");
+    shader.locs[SHADER_LOC_VERTEX_NORMAL] = rlGetLocationAttrib(program, "vertexNormal");
+    shader.locs[SHADER_LOC_VERTEX_TANGENT] = rlGetLocationAttrib(program, "vertexTangent");
+    shader.locs[SHADER_LOC_VERTEX_COLOR] = rlGetLocationAttrib(program, "vertexColor");
+    shader.locs[SHADER_LOC_MATRIX_MVP] = rlGetLocationUniform(program, "mvp");
+    shader.locs[SHADER_LOC_MATRIX_VIEW] = rlGetLocationUniform(program, "matView");
+    shader.locs[SHADER_LOC_MATRIX_PROJECTION] = rlGetLocationUniform(program, "matProjection");
+    shader.locs[SHADER_LOC_MATRIX_MODEL] = rlGetLocationUniform(program, "matModel");
+    shader.locs[SHADER_LOC_MATRIX_NORMAL] = rlGetLocationUniform(program, "matNormal");
+    shader.locs[SHADER_LOC_COLOR_DIFFUSE] = rlGetLocationUniform(program, "colDiffuse");
+    shader.locs[SHADER_LOC_MAP_DIFFUSE] = rlGetLocationUniform(program, "texture0");
+    shader.locs[SHADER_LOC_MAP_SPECULAR] = rlGetLocationUniform(program, "texture1");
+    shader.locs[SHADER_LOC_MAP_NORMAL] = rlGetLocationUniform(program, "texture2");
+    return shader;
+}
+
+static bool ParseInt(const char*& p, int& value) {
+    if (!isdigit(*p)) {
+        return false;
+    }
+    value = 0;
+    while (isdigit(*p)) {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    return true;
+}
+
+TextEditor::ErrorMarkers ParseInfoLog(const std::string& log) {
+    TextEditor::ErrorMarkers markers;
+    size_t start = 0;
+    while (start < log.size()) {
+        size_t end = log.find('\n', start);
+        if (end == std::string::npos) end = log.size();
+        std::string line = log.substr(start, end - start);
+        start = end + 1;
+        const char* p = line.c_str();
+        // AMD and Intel prefix the location with the severity
+        if (!strncmp(p, "ERROR: ", 7)) p += 7;
+        else if (!strncmp(p, "WARNING: ", 9)) p += 9;
+        int source, lineno;
+        if (!ParseInt(p, source)) {
+            continue;
+        }
+        if (*p == ':') {
+            // Mesa "0:12(5): error: ...", AMD/Intel "0:12: ..."
+            p++;
+            if (!ParseInt(p, lineno)) continue;
+            if (*p == '(') {
+                int column;
+                p++;
+                if (!ParseInt(p, column) || *p != ')') continue;
+                p++;
+            }
+        } else if (*p == '(') {
+            // NVIDIA "0(12) : error C0000: ..."
+            p++;
+            if (!ParseInt(p, lineno) || *p != ')') continue;
+            p++;
+        } else {
+            continue;
+        }
+        while (*p == ' ' || *p == ':') p++;
+        std::string message = p;
+        if (markers.count(lineno) > 0) {
+            markers[lineno] += "\n" + message;
+        } else {
+            markers[lineno] = message;
+        }
+    }
+    return markers;
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+#include <raylib.h>
+
+#include "ImGuiColorTextEdit/TextEditor.h"
+
+// seconds of typing inactivity before the editor buffer is compiled in the background
+#define LIVE_COMPILE_DELAY 0.35
+
+// Compiles shader programs on a worker thread with its own hidden GL context that shares objects
+// with the main one, so linked programs can be used by the render thread as soon as they are done.
+// Falls back to compiling on the render thread from Poll() if no shared context could be created.
+namespace ShaderCompiler {
+    typedef struct {
+        bool success;
+        unsigned int program;
+        std::string log;
+        // driver messages for the fragment shader keyed by line (1-based, as the editor expects)
+        TextEditor::ErrorMarkers markers;
+    } Result;
+
+    // Call from the render thread after InitWindow.
+    bool Init();
+    void Shutdown();
+    // Queue a compile for owner, replacing any not yet started compile of the same owner.
+    void Submit(int owner, std::string vertexCode, std::string fragmentCode);
+    // Take the result of the newest compile submitted for owner once it has finished.
+    bool Poll(int owner, Result& result);
+    bool IsBusy(int owner);
+    // Drop queued and finished compiles of owner, results still in flight are discarded when done.
+    void Cancel(int owner);
+    // Raylib shader around a linked program, with the default locations LoadShaderFromMemory would look up.
+    Shader ShaderFromProgram(unsigned int program);
+    // Parse driver info log messages ("0:12(5): error: ...", "0(12) : error ...", "ERROR: 0:12: ...") into line markers.
+    TextEditor::ErrorMarkers ParseInfoLog(const std::string& log);
+}
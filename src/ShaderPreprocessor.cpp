@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+
+#include "ShaderPreprocessor.hpp"
+
+namespace ShaderPreprocessor {
+
+typedef struct {
+    // 0-based line of the directive
+    int line;
+    // the name between the quotes
+    std::string target;
+} Include;
+
+typedef struct {
+    std::filesystem::file_time_type mtime;
+    std::string text;
+    std::vector<size_t> line_starts;
+    std::vector<Include> includes;
+    // line of "#pragma once", -1 without one
+    int once_line = -1;
+} File;
+
+typedef struct {
+    Result& result;
+    // files being expanded, to catch a file that ends up including itself
+    std::vector<std::string> stack;
+    // files with "#pragma once" that were already pasted in
+    std::set<std::string> once;
+} Expansion;
+
+// parsed include files by absolute path
+std::map<std::string, std::shared_ptr<const File>> cache;
+std::mutex mutex;
+
+bool MatchWord(const char*& p, const char* end, const char* word) {
+    size_t n = strlen(word);
+    if ((size_t)(end - p) < n || strncmp(p, word, n) != 0) {
+        return false;
+    }
+    p += n;
+    return true;
+}
+
+void SkipSpaces(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+}
+
+// find line starts and the directives handled here
+void Parse(File& file) {
+    const std::string& text = file.text;
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        int line = file.line_starts.size();
+        file.line_starts.push_back(start);
+        const char* p = text.c_str() + start;
+        const char* e = text.c_str() + end;
+        SkipSpaces(p, e);
+        if (p < e && *p == '#') {
+            p++;
+            SkipSpaces(p, e);
+            if (MatchWord(p, e, "include")) {
+                SkipSpaces(p, e);
+                const char* close = p < e && *p == '"' ? (const char*)memchr(p + 1, '"', e - p - 1) : nullptr;
+                if (close != nullptr) {
+                    file.includes.push_back({line, std::string(p + 1, close)});
+                }
+            } else if (MatchWord(p, e, "pragma")) {
+                SkipSpaces(p, e);
+                if (MatchWord(p, e, "once")) {
+                    file.once_line = line;
+                }
+            }
+        }
+        start = end + 1;
+    }
+}
+
+std::shared_ptr<const File> GetFile(const std::string& path) {
+    std::error_code err;
+    auto mtime = std::filesystem::last_write_time(path, err);
+    if (err) {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(path);
+        if (it != cache.end() && it->second->mtime == mtime) {
+            return it->second;
+        }
+    }
+    std::ifstream fd(path, std::ios::in | std::ios::binary);
+    if (!fd.is_open()) {
+        return nullptr;
+    }
+    auto file = std::make_shared<File>();
+    file->mtime = mtime;
+    file->text.assign(std::istreambuf_iterator<char>(fd), std::istreambuf_iterator<char>());
+    Parse(*file);
+    std::lock_guard<std::mutex> lock(mutex);
+    cache[path] = file;
+    return file;
+}
+
+bool Resolve(const std::filesystem::path& dir, const std::string& target, std::string& path) {
+    for (auto& base : {dir, std::filesystem::path()}) {
+        std::error_code err;
+        std::filesystem::path p = std::filesystem::absolute(base / target, err).lexically_normal();
+        if (!err && std::filesystem::is_regular_file(p, err)) {
+            path = p.string();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IncludeFile(Expansion& x, const std::filesystem::path& dir, const std::string& target, int root_line);
+
+bool Expand(Expansion& x, const File& file, int index, const std::filesystem::path& dir, int root_line) {
+    size_t next = 0;
+    int count = file.line_starts.size();
+    for (int i=0; i<count; i++) {
+        // lines of the shader itself are their own root
+        int root = index == 0 ? i + 1 : root_line;
+        if (next < file.includes.size() && file.includes[next].line == i) {
+            if (!IncludeFile(x, dir, file.includes[next++].target, root)) {
+                return false;
+            }
+            continue;
+        }
+        if (i == file.once_line) {
+            continue;
+        }
+        size_t start = file.line_starts[i];
+        size_t end = i + 1 < count ? file.line_starts[i + 1] : file.text.size();
+        x.result.code.append(file.text, start, end - start);
+        if (end == start || file.text[end - 1] != '\n') {
+            x.result.code += '\n';
+        }
+        x.result.lines.push_back({index, i + 1, root});
+    }
+    return true;
+}
+
+bool IncludeFile(Expansion& x, const std::filesystem::path& dir, const std::string& target, int root_line) {
+    std::string path;
+    std::shared_ptr<const File> file;
+    if (!Resolve(dir, target, path) || (file = GetFile(path)) == nullptr) {
+        x.result.error = "can't open #include \"" + target + "\"";
+        x.result.error_line = root_line;
+        return false;
+    }
+    if (std::find(x.stack.begin(), x.stack.end(), path) != x.stack.end()) {
+        x.result.error = "#include \"" + target + "\" includes itself";
+        x.result.error_line = root_line;
+        return false;
+    }
+    if (x.stack.size() >= SHADER_INCLUDE_MAX_DEPTH) {
+        x.result.error = "#include \"" + target + "\" is nested too deeply";
+        x.result.error_line = root_line;
+        return false;
+    }
+    if (file->once_line >= 0 && !x.once.insert(path).second) {
+        return true;
+    }
+    auto it = std::find(x.result.files.begin(), x.result.files.end(), path);
+    int index = it - x.result.files.begin();
+    if (it == x.result.files.end()) {
+        x.result.files.push_back(path);
+    }
+    x.stack.push_back(path);
+    bool ok = Expand(x, *file, index, std::filesystem::path(path).parent_path(), root_line);
+    x.stack.pop_back();
+    return ok;
+}
+
+bool Process(const std::string& path, const std::string& code, Result& result) {
+    result = Result();
+    result.files.push_back(path);
+    File file;
+    file.text = code;
+    Parse(file);
+    if (file.includes.empty()) {
+        result.code = code;
+        return true;
+    }
+    Expansion x = {result, {}, {}};
+    if (!Expand(x, file, 0, std::filesystem::path(path).parent_path(), 0)) {
+        result.code.clear();
+        result.lines.clear();
+        return false;
+    }
+    return true;
+}
+
+// parse a variant line between start and end, false if it isn't one
+bool ParseVariant(const std::string& code, size_t start, size_t end, VariantKey& key) {
+    const char* p = code.c_str() + start;
+    const char* e = code.c_str() + end;
+    SkipSpaces(p, e);
+    if (!MatchWord(p, e, "//#variant") || p >= e || (*p != ' ' && *p != '\t')) {
+        return false;
+    }
+    std::vector<std::string> words;
+    while (true) {
+        SkipSpaces(p, e);
+        const char* w = p;
+        while (p < e && !isspace(*p)) p++;
+        if (p == w) {
+            break;
+        }
+        words.emplace_back(w, p);
+    }
+    if (words.size() < 2) {
+        return false;
+    }
+    key.name = words[0];
+    key.values.assign(words.begin() + 1, words.end());
+    return true;
+}
+
+std::vector<VariantKey> FindVariants(const std::string& code) {
+    std::vector<VariantKey> keys;
+    for (size_t pos = code.find("//#variant"); pos != std::string::npos; pos = code.find("//#variant", pos + 1)) {
+        size_t start = code.rfind('\n', pos);
+        start = start == std::string::npos ? 0 : start + 1;
+        size_t end = code.find('\n', pos);
+        if (end == std::string::npos) end = code.size();
+        VariantKey key;
+        if (!ParseVariant(code, start, end, key)) {
+            continue;
+        }
+        bool known = false;
+        for (auto& k : keys) {
+            known |= k.name == key.name;
+        }
+        if (!known) {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+std::string ApplyVariants(const std::string& code, const std::map<std::string, std::string>& selection) {
+    std::string applied;
+    size_t copied = 0;
+    for (size_t pos = code.find("//#variant"); pos != std::string::npos; pos = code.find("//#variant", pos + 1)) {
+        size_t start = code.rfind('\n', pos);
+        start = start == std::string::npos ? 0 : start + 1;
+        size_t end = code.find('\n', pos);
+        if (end == std::string::npos) end = code.size();
+        VariantKey key;
+        if (!ParseVariant(code, start, end, key)) {
+            continue;
+        }
+        std::string value = key.values[0];
+        auto it = selection.find(key.name);
+        if (it != selection.end() && std::find(key.values.begin(), key.values.end(), it->second) != key.values.end()) {
+            value = it->second;
+        }
+        applied.append(code, copied, start - copied);
+        applied += "#define " + key.name + " " + value;
+        copied = end;
+    }
+    if (copied == 0) {
+        return code;
+    }
+    applied.append(code, copied, std::string::npos);
+    return applied;
+}
+
+TextEditor::ErrorMarkers MapMarkers(const Result& result, const TextEditor::ErrorMarkers& markers) {
+    if (result.lines.empty()) {
+        return markers;
+    }
+    TextEditor::ErrorMarkers mapped;
+    for (auto& m : markers) {
+        int line = m.first;
+        std::string message = m.second;
+        if (line >= 1 && line <= (int)result.lines.size()) {
+            const SourceLine& source = result.lines[line - 1];
+            if (source.file != 0) {
+                message = std::filesystem::path(result.files[source.file]).filename().string() + ":" +
+                    std::to_string(source.line) + ": " + message;
+            }
+            line = source.root_line;
+        }
+        std::string& slot = mapped[line];
+        if (!slot.empty()) {
+            slot += "\n";
+        }
+        slot += message;
+    }
+    return mapped;
+}
+
+}
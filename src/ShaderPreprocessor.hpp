@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ImGuiColorTextEdit/TextEditor.h"
+
+// include files nested deeper than this are assumed to be a mistake
+#define SHADER_INCLUDE_MAX_DEPTH 32
+
+// Expands #include "file" lines in shader source before it is compiled.
+// Files are looked up next to the file including them, then relative to the working directory.
+// Included files are parsed once and kept until their modification time changes, a file with
+// "#pragma once" is only pasted in the first time it is included.
+// Variant keys ("//#variant NAME value...") are left in place by Process and turned into defines by ApplyVariants.
+namespace ShaderPreprocessor {
+    typedef struct {
+        // index into Result::files, 0 is the shader itself
+        int file;
+        // line in that file, and the line of the shader that pulled it in (1-based)
+        int line;
+        int root_line;
+    } SourceLine;
+
+    typedef struct {
+        std::string code;
+        // where each line of code came from, empty when there were no includes and the lines are unchanged
+        std::vector<SourceLine> lines;
+        // the shader followed by every file it includes, directly or not
+        std::vector<std::string> files;
+        // set when Process fails, error_line is the line of the shader with the bad #include
+        std::string error;
+        int error_line = 0;
+    } Result;
+
+    // a "//#variant NAME value..." line, compiled as "#define NAME value" with one of the values
+    typedef struct {
+        std::string name;
+        std::vector<std::string> values;
+    } VariantKey;
+
+    // Expand the includes of code, the contents of the shader at path. Thread safe.
+    bool Process(const std::string& path, const std::string& code, Result& result);
+    // Move compiler messages for lines of result.code to the shader's own lines, messages from an included
+    // file go on its #include line, prefixed with the file name and line.
+    TextEditor::ErrorMarkers MapMarkers(const Result& result, const TextEditor::ErrorMarkers& markers);
+    // Variant keys declared in code, in order.
+    std::vector<VariantKey> FindVariants(const std::string& code);
+    // Turn the variant lines of code into defines, with the value picked in selection (by name) or the first one.
+    // Lines stay where they are, so line numbers don't change.
+    std::string ApplyVariants(const std::string& code, const std::map<std::string, std::string>& selection);
+}
@@ -0,0 +1,89 @@
+#include <raylib.h>
+
+#ifdef WIN32
+#include <process.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "SharedMemory.hpp"
+#include "MemoryTracker.hpp"
+
+SharedMemory::~SharedMemory() {
+    Close();
+}
+
+std::string SharedMemory::SegmentName(const std::string& suffix) {
+#ifdef WIN32
+    int pid = _getpid();
+#else
+    int pid = getpid();
+#endif
+    return "/pstb-" + std::to_string(pid) + "-" + suffix;
+}
+
+bool SharedMemory::Create(const std::string& segment, size_t bytes) {
+#ifdef WIN32
+    TraceLog(LOG_WARNING, "Shared memory output is only available on Linux and macOS");
+    return false;
+#else
+    if (IsOpen() && segment == name && bytes <= size) {
+        return true;
+    }
+    if (IsOpen() && segment != name) {
+        Close();
+    }
+    if (fd < 0) {
+        fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 && errno == EEXIST && segment.find("/pstb-" + std::to_string(getpid()) + "-") == 0) {
+            // named after this process but not open here, so left behind by an earlier process with the same pid
+            shm_unlink(segment.c_str());
+            fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        }
+        if (fd < 0) {
+            TraceLog(LOG_WARNING, "Failed to create shared memory %s", segment.c_str());
+            return false;
+        }
+        name = segment;
+    }
+    if (data != nullptr) {
+        munmap(data, size);
+        data = nullptr;
+    }
+    if (ftruncate(fd, bytes) != 0) {
+        TraceLog(LOG_WARNING, "Failed to resize shared memory %s to %zu bytes", segment.c_str(), bytes);
+        Close();
+        return false;
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        TraceLog(LOG_WARNING, "Failed to map shared memory %s", segment.c_str());
+        Close();
+        return false;
+    }
+    data = p;
+    size = bytes;
+    MemoryTracker::Track(MEMORY_SHARED, (uintptr_t)this, bytes, MEMORY_NO_OWNER, name);
+    return true;
+#endif
+}
+
+void SharedMemory::Close() {
+    MemoryTracker::Untrack(MEMORY_SHARED, (uintptr_t)this);
+#ifndef WIN32
+    if (data != nullptr) {
+        munmap(data, size);
+    }
+    if (fd >= 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    fd = -1;
+    name.clear();
+}
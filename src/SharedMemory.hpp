@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// A named block of memory other local processes can map (POSIX shm_open), used to hand them pixels
+// without going through files or sockets. The segment is removed again when it is closed, and creating one
+// that already exists fails, so two processes never share a segment by accident.
+class SharedMemory {
+    std::string name;
+    void* data = nullptr;
+    size_t size = 0;
+    int fd = -1;
+
+    public:
+    SharedMemory() {}
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+    ~SharedMemory();
+    // "/pstb-<pid>-<suffix>", unique to this process and short enough for macOS (31 characters)
+    static std::string SegmentName(const std::string& suffix);
+    // Create the segment called name ("/something") with room for size bytes, or grow it if it is already open.
+    // Growing maps it again, so pointers from Data() are only good until the next Create.
+    bool Create(const std::string& name, size_t size);
+    void Close();
+    bool IsOpen() const { return data != nullptr; }
+    void* Data() const { return data; }
+    size_t Size() const { return size; }
+    const std::string& Name() const { return name; }
+};
@@ -0,0 +1,251 @@
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+#include <raylib.h>
+#include <rlgl.h>
+#include <external/glad.h>
+
+#include "Sweep.hpp"
+#include "ModelCache.hpp"
+#include "RenderTargetPool.hpp"
+#include "nlohmann/json.hpp"
+
+namespace Sweep {
+
+// a number sets every component, an array sets them in order
+bool ReadValue(const nlohmann::json& j, Uniform& value) {
+    value = {0};
+    if (j.is_number()) {
+        for (int i=0; i<4; i++) {
+            value.v[i] = j.get<float>();
+        }
+        return true;
+    }
+    if (!j.is_array() || j.size() < 1 || j.size() > 4) {
+        return false;
+    }
+    for (int i=0; i<(int)j.size(); i++) {
+        if (!j[i].is_number()) {
+            return false;
+        }
+        value.v[i] = j[i].get<float>();
+    }
+    return true;
+}
+
+bool ReadAxis(const nlohmann::json& j, Axis& axis) {
+    if (!j.is_object() || !j.contains("name") || !j["name"].is_string()) {
+        return false;
+    }
+    axis.name = j["name"].get<std::string>();
+    axis.values.clear();
+    if (j.contains("values")) {
+        if (!j["values"].is_array()) {
+            return false;
+        }
+        for (auto& v : j["values"]) {
+            Uniform value;
+            if (!ReadValue(v, value)) {
+                return false;
+            }
+            axis.values.push_back(value);
+        }
+        return axis.values.size() > 0 && axis.values.size() <= SWEEP_MAX_TILES;
+    }
+    Uniform from, to;
+    if (!j.contains("from") || !j.contains("to") || !ReadValue(j["from"], from) || !ReadValue(j["to"], to)) {
+        return false;
+    }
+    int steps = j.contains("steps") && j["steps"].is_number_integer() ? j["steps"].get<int>() : 2;
+    // checked before the values are generated, an absurd count would otherwise allocate them all
+    if (steps < 1 || steps > SWEEP_MAX_TILES) {
+        return false;
+    }
+    for (int s=0; s<steps; s++) {
+        float t = steps > 1 ? s / (float)(steps - 1) : 0.0f;
+        Uniform value = {0};
+        for (int i=0; i<4; i++) {
+            value.v[i] = from.v[i] + (to.v[i] - from.v[i]) * t;
+        }
+        axis.values.push_back(value);
+    }
+    return true;
+}
+
+bool LoadJob(const std::string& path, Job& job) {
+    std::ifstream fd(path);
+    if (!fd.is_open()) {
+        TraceLog(LOG_WARNING, "Failed to open sweep job %s", path.c_str());
+        return false;
+    }
+    nlohmann::json j = nlohmann::json::parse(fd, nullptr, false);
+    if (!j.is_object()) {
+        TraceLog(LOG_WARNING, "Sweep job %s is not a json object", path.c_str());
+        return false;
+    }
+    job = Job();
+    job.output = "sweep.png";
+    if (j.contains("shader") && j["shader"].is_string()) job.shader = j["shader"].get<std::string>();
+    if (j.contains("model") && j["model"].is_string()) job.model = j["model"].get<std::string>();
+    if (j.contains("output") && j["output"].is_string()) job.output = j["output"].get<std::string>();
+    if (j.contains("tile_width") && j["tile_width"].is_number_integer()) job.tile_width = j["tile_width"].get<int>();
+    if (j.contains("tile_height") && j["tile_height"].is_number_integer()) job.tile_height = j["tile_height"].get<int>();
+    if (j.contains("columns") && j["columns"].is_number_integer()) job.columns = j["columns"].get<int>();
+    if (j.contains("time") && j["time"].is_number()) job.time = j["time"].get<float>();
+    if (!j.contains("uniforms") || !j["uniforms"].is_array() || j["uniforms"].size() < 1) {
+        TraceLog(LOG_WARNING, "Sweep job %s has no uniforms to sweep", path.c_str());
+        return false;
+    }
+    for (auto& u : j["uniforms"]) {
+        Axis axis;
+        if (!ReadAxis(u, axis)) {
+            TraceLog(LOG_WARNING, "Sweep job %s: bad uniform %s", path.c_str(), u.dump().c_str());
+            return false;
+        }
+        job.axes.push_back(axis);
+    }
+    if (job.tile_width < 1 || job.tile_height < 1 || job.tile_width > SWEEP_MAX_TILE_SIZE ||
+        job.tile_height > SWEEP_MAX_TILE_SIZE || job.columns < 0) {
+        TraceLog(LOG_WARNING, "Sweep job %s: bad tile size or columns", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// the Uniform SetUniform expects for a value of type
+Uniform Convert(const Uniform& value, ShaderUniformType type) {
+    Uniform converted = value;
+    if (type == INT) {
+        converted.i = (int)roundf(value.v[0]);
+    }
+    return converted;
+}
+
+bool Run(PixelShader& ps, const Job& job) {
+    if (!ps.IsReady()) {
+        TraceLog(LOG_WARNING, "Can't run a sweep, %s isn't compiled", ps.name.c_str());
+        return false;
+    }
+    std::vector<ShaderUniformType> types;
+    int tiles = 1;
+    for (auto& axis : job.axes) {
+        for (auto& b : ps.baked) {
+            if (b.name == axis.name) {
+                TraceLog(LOG_WARNING, "Can't sweep %s, it is baked into %s", axis.name.c_str(), ps.name.c_str());
+                return false;
+            }
+        }
+        auto loc = ps.shader_locs.find(axis.name);
+        if (loc == ps.shader_locs.end() || ps.other_uniform_buffers.count(axis.name) < 1 ||
+            loc->second.second == SAMPLER2D || loc->second.second == MATRIX) {
+            TraceLog(LOG_WARNING, "Can't sweep %s, %s has no number or vector uniform by that name", axis.name.c_str(), ps.name.c_str());
+            return false;
+        }
+        types.push_back(loc->second.second);
+        tiles *= axis.values.size();
+        if (tiles > SWEEP_MAX_TILES) {
+            TraceLog(LOG_WARNING, "Sweep has more than %d combinations", SWEEP_MAX_TILES);
+            return false;
+        }
+    }
+    int columns = job.columns > 0 ? job.columns : job.axes[0].values.size();
+    if (columns > tiles) {
+        columns = tiles;
+    }
+    int rows = (tiles + columns - 1) / columns;
+    int max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    // compared by division so the size of a huge sheet can't overflow into a small one
+    if (job.tile_width < 1 || job.tile_height < 1 || job.tile_width > max_size / columns || job.tile_height > max_size / rows) {
+        TraceLog(LOG_WARNING, "Sweep contact sheet of %dx%d tiles of %dx%d is larger than the %d textures the GPU allows",
+            columns, rows, job.tile_width, job.tile_height, max_size);
+        return false;
+    }
+    int width = columns * job.tile_width;
+    int height = rows * job.tile_height;
+    RenderTexture2D sheet = RenderTargetPool::Acquire(width, height, ps.num);
+    if (!IsRenderTextureReady(sheet)) {
+        TraceLog(LOG_WARNING, "Failed to create a %dx%d render texture for the sweep", width, height);
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Uniform> saved;
+    for (auto& axis : job.axes) {
+        saved.push_back(ps.other_uniform_buffers[axis.name]);
+    }
+    float runtime = ps.runtime;
+    unsigned int frame_counter = ps.frame_counter;
+    ps.runtime = job.time;
+
+    BeginTextureMode(sheet);
+    ClearBackground(ps.clearColor);
+    for (int t=0; t<tiles; t++) {
+        int index = t;
+        for (int a=0; a<(int)job.axes.size(); a++) {
+            int n = job.axes[a].values.size();
+            Uniform value = Convert(job.axes[a].values[index % n], types[a]);
+            ps.SetUniform(job.axes[a].name, types[a], value.v);
+            index /= n;
+        }
+        // tiles fill the sheet from the top left, GL viewports count from the bottom
+        int x = (t % columns) * job.tile_width;
+        int y = height - (t / columns + 1) * job.tile_height;
+        ps.Render(0, x, y, job.tile_width, job.tile_height);
+    }
+    EndTextureMode();
+
+    for (int a=0; a<(int)job.axes.size(); a++) {
+        ps.SetUniform(job.axes[a].name, types[a], saved[a].v);
+        ps.other_uniform_buffers[job.axes[a].name] = saved[a];
+    }
+    ps.runtime = runtime;
+    ps.frame_counter = frame_counter;
+
+    Image img = LoadImageFromTexture(sheet.texture);
+    RenderTargetPool::Release(sheet);
+    ImageFlipVertical(&img);
+    if (IsFileExtension(job.output.c_str(), ".jpg") || IsFileExtension(job.output.c_str(), ".jpeg")) {
+        ImageFormat(&img, PIXELFORMAT_UNCOMPRESSED_R8G8B8);
+    }
+    bool ok = ExportImage(img, job.output.c_str());
+    UnloadImage(img);
+    if (!ok) {
+        TraceLog(LOG_WARNING, "Failed to export image %s!", job.output.c_str());
+        return false;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    TraceLog(LOG_INFO, "Swept %d combinations of %s into %s (%dx%d) in %.1f ms", tiles, ps.name.c_str(), job.output.c_str(), width, height, ms);
+    return true;
+}
+
+bool RunFile(const std::string& path) {
+    Job job;
+    if (!LoadJob(path, job)) {
+        return false;
+    }
+    if (job.shader.empty()) {
+        TraceLog(LOG_WARNING, "Sweep job %s doesn't name a shader", path.c_str());
+        return false;
+    }
+    PixelShader ps(job.shader.c_str());
+    ps.Setup(job.tile_width, job.tile_height);
+    if (!job.model.empty()) {
+        ps.LoadModel(job.model);
+        while (!ps.modelPending.empty()) {
+            ModelCache::Poll(0.1f);
+            ps.PollModel();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (ps.modelPath != job.model) {
+            TraceLog(LOG_WARNING, "Failed to load model %s for the sweep", job.model.c_str());
+        }
+    }
+    bool ok = Run(ps, job);
+    ps.Unload();
+    return ok;
+}
+
+}
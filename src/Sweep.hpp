@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PixelShader.hpp"
+
+// sweeps with more combinations than this are refused, each one is a draw of the whole shader
+#define SWEEP_MAX_TILES 4096
+// largest tile_width and tile_height a job may ask for
+#define SWEEP_MAX_TILE_SIZE 4096
+
+// Renders a shader over ranges of its uniforms and packs the renders into a contact sheet.
+// Every combination of the swept values is drawn into its own tile of one large render texture, so a
+// whole sheet is a single framebuffer bind and a single read back no matter how many tiles it has.
+// Jobs are json files:
+// {
+//     "shader": "shaders/terrain.fs",
+//     "model": "models/plane.obj",
+//     "tile_width": 128, "tile_height": 128,
+//     "columns": 16,
+//     "time": 0,
+//     "uniforms": [
+//         {"name": "height_scale", "from": 0.1, "to": 10, "steps": 16},
+//         {"name": "tint", "values": [[1, 0, 0], [0, 1, 0], 0.5]}
+//     ],
+//     "output": "sweep.png"
+// }
+// The first uniform changes along a row, the next ones once a row is used up (columns defaults to the
+// number of values of the first uniform, so two uniforms make a grid). Vector uniforms take arrays, a
+// single number sets every component. "shader" and "model" are only used from the command line, a sweep
+// started from a shader window renders that shader with its current settings.
+namespace Sweep {
+    typedef struct {
+        std::string name;
+        // components of each value, as floats whatever the uniform's type
+        std::vector<Uniform> values;
+    } Axis;
+
+    typedef struct {
+        std::string shader, model, output;
+        int tile_width = 128, tile_height = 128;
+        // 0 for the number of values of the first axis
+        int columns = 0;
+        float time = 0;
+        std::vector<Axis> axes;
+    } Job;
+
+    bool LoadJob(const std::string& path, Job& job);
+    // Render the contact sheet of job with ps and export it to job.output. The swept uniforms, time and frame
+    // of ps are put back afterwards. Call from the render thread, outside of any texture mode.
+    bool Run(PixelShader& ps, const Job& job);
+    // Load the job at path and the shader it names and render it, for running sweeps without the GUI.
+    bool RunFile(const std::string& path);
+}
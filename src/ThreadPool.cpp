@@ -0,0 +1,53 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned int threads) {
+    if (threads == 0) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        threads = cores > 2 ? cores - 1 : 1;
+    }
+    for (unsigned int i=0; i<threads; i++) {
+        workers.emplace_back(&ThreadPool::Run, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    Shutdown();
+}
+
+void ThreadPool::Run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (stopping) {
+            break;
+        }
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    cv.notify_one();
+}
+
+void ThreadPool::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    cv.notify_all();
+    for (auto& w : workers) {
+        if (w.joinable()) {
+            w.join();
+        }
+    }
+    workers.clear();
+}
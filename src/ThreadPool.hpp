@@ -0,0 +1,27 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running jobs in the order they were submitted.
+// Jobs must not touch GL, anything that needs the context goes back to the render thread.
+class ThreadPool {
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    void Run();
+
+    public:
+    // threads = 0 uses one thread per core, leaving one for the render thread
+    ThreadPool(unsigned int threads = 0);
+    ~ThreadPool();
+    void Submit(std::function<void()> job);
+    // Drop jobs that haven't started and wait for the running ones.
+    void Shutdown();
+};
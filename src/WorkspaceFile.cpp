@@ -0,0 +1,304 @@
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "WorkspaceFile.hpp"
+
+#define WORKSPACE_BINARY_MAGIC 0x42575350 // "PSWB"
+#define WORKSPACE_BINARY_VERSION 1
+
+namespace WorkspaceFile {
+
+const Camera3D default_camera = {{0, 0, -4}, {0, 0, -3}, {0, 1, 0}, 90.0, CAMERA_PERSPECTIVE};
+
+ShaderSnapshot Snapshot(PixelShader* ps) {
+    ShaderSnapshot s;
+    s.filename = ps->filename;
+    s.id = ps->num;
+    s.width = ps->rt_width;
+    s.height = ps->rt_height;
+    s.camera = ps->camera;
+    s.clear_color = ps->clearColor;
+    if (ps->modelFilebuf != nullptr && ps->modelFilebuf[0] > 0) {
+        s.model = ps->modelFilebuf;
+    }
+    s.instance_count = ps->instance_count;
+    s.instance_layout = ps->instance_layout;
+    s.instance_spacing = ps->instance_spacing;
+    s.uniforms = ps->SnapshotUniforms();
+    return s;
+}
+
+nlohmann::json ToJson(const std::vector<ShaderSnapshot>& shaders) {
+    nlohmann::json json = nlohmann::json::object();
+    for (auto& s : shaders) {
+        const Camera3D& c = s.camera;
+        nlohmann::json j = {
+            {"uniforms", UniformsToJson(s.uniforms)},
+            {"width", s.width},
+            {"height", s.height},
+            {"id", s.id},
+            {"camera", {
+                {"position", nlohmann::json::array({c.position.x, c.position.y, c.position.z})},
+                {"target", nlohmann::json::array({c.target.x, c.target.y, c.target.z})},
+                {"up", nlohmann::json::array({c.up.x, c.up.y, c.up.z})},
+            }},
+            {"clear_color", nlohmann::json::array({s.clear_color.r, s.clear_color.g, s.clear_color.b, s.clear_color.a})},
+        };
+        if (s.model.size() > 0) {
+            j["model"] = s.model;
+        }
+        if (s.instance_count > 1) {
+            j["instances"] = {
+                {"count", s.instance_count},
+                {"layout", s.instance_layout},
+                {"spacing", s.instance_spacing},
+            };
+        }
+        json[s.filename] = j;
+    }
+    return json;
+}
+
+static void ReadVector3(const nlohmann::json& json, Vector3& dest) {
+    if (!json.is_array() || json.size() < 3) {
+        return;
+    }
+    float v[3];
+    for (int i=0; i<3; i++) {
+        if (!json[i].is_number()) return;
+        v[i] = json[i].get<float>();
+    }
+    dest = {v[0], v[1], v[2]};
+}
+
+bool FromJson(const nlohmann::json& json, std::vector<ShaderSnapshot>& shaders) {
+    if (!json.is_object() || !json.contains("shaders") || !json["shaders"].is_object()) {
+        return false;
+    }
+    for (auto s : json["shaders"].items()) {
+        const nlohmann::json& j = s.value();
+        if (!j.is_object()) continue;
+        ShaderSnapshot shader;
+        shader.filename = s.key();
+        shader.id = j.contains("id") && j["id"].is_number_integer() ? j["id"].get<int>() : -1;
+        // -1 leaves the size the shader is created with
+        shader.width = j.contains("width") && j["width"].is_number() ? j["width"].get<int>() : -1;
+        shader.height = j.contains("height") && j["height"].is_number() ? j["height"].get<int>() : shader.width;
+        shader.camera = default_camera;
+        if (j.contains("camera") && j["camera"].is_object()) {
+            auto& cam = j["camera"];
+            if (cam.contains("position")) ReadVector3(cam["position"], shader.camera.position);
+            if (cam.contains("target")) ReadVector3(cam["target"], shader.camera.target);
+            if (cam.contains("up")) ReadVector3(cam["up"], shader.camera.up);
+        }
+        shader.clear_color = {0, 0, 0, 0};
+        if (j.contains("clear_color") && j["clear_color"].is_array()) {
+            auto& arr = j["clear_color"];
+            unsigned char* c = (unsigned char*)&shader.clear_color;
+            for (int i=0; i<4 && i<(int)arr.size(); i++) {
+                if (arr[i].is_number_integer()) {
+                    c[i] = arr[i].get<int>();
+                }
+            }
+        }
+        if (j.contains("model") && j["model"].is_string()) {
+            shader.model = j["model"].get<std::string>();
+        }
+        shader.instance_count = 1;
+        shader.instance_layout = INSTANCE_LAYOUT_SINGLE;
+        shader.instance_spacing = 2.5f;
+        if (j.contains("instances") && j["instances"].is_object()) {
+            auto& inst = j["instances"];
+            if (inst.contains("count") && inst["count"].is_number_integer()) {
+                shader.instance_count = inst["count"].get<int>();
+            }
+            if (inst.contains("layout") && inst["layout"].is_number_integer()) {
+                shader.instance_layout = inst["layout"].get<int>();
+            }
+            if (inst.contains("spacing") && inst["spacing"].is_number()) {
+                shader.instance_spacing = inst["spacing"].get<float>();
+            }
+        }
+        if (j.contains("uniforms")) {
+            shader.uniforms = UniformsFromJson(j["uniforms"]);
+        }
+        shaders.push_back(std::move(shader));
+    }
+    return true;
+}
+
+// the binary format is a header followed by one record per shader, in native byte order:
+// u32 magic, u32 version, u32 shader count
+// per shader: string filename, i32 id, width, height, f32[10] camera position/target/up/fovy, i32 projection,
+// u8[4] clear color, string model, i32 instance count, i32 instance layout, f32 instance spacing, u32 uniform count
+// per uniform: string name, i32 type, then a string for samplers or u8 isSet + 16 bytes of value for the others
+// strings are a u32 length followed by the bytes
+
+class BinaryWriter {
+    public:
+    std::string data;
+    template<class T>
+    void Put(T value) {
+        data.append((const char*)&value, sizeof(T));
+    }
+    void PutString(const std::string& str) {
+        Put<uint32_t>(str.size());
+        data += str;
+    }
+};
+
+class BinaryReader {
+    const std::string& data;
+    size_t pos = 0;
+    public:
+    bool ok = true;
+    BinaryReader(const std::string& data) : data(data) {}
+    template<class T>
+    T Get() {
+        T value = {};
+        if (!ok || data.size() - pos < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, &data[pos], sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+    std::string GetString() {
+        uint32_t length = Get<uint32_t>();
+        if (!ok || data.size() - pos < length) {
+            ok = false;
+            return "";
+        }
+        std::string str = data.substr(pos, length);
+        pos += length;
+        return str;
+    }
+};
+
+std::string ToBinary(const std::vector<ShaderSnapshot>& shaders) {
+    BinaryWriter w;
+    w.Put<uint32_t>(WORKSPACE_BINARY_MAGIC);
+    w.Put<uint32_t>(WORKSPACE_BINARY_VERSION);
+    w.Put<uint32_t>(shaders.size());
+    for (auto& s : shaders) {
+        const Camera3D& c = s.camera;
+        w.PutString(s.filename);
+        w.Put<int32_t>(s.id);
+        w.Put<int32_t>(s.width);
+        w.Put<int32_t>(s.height);
+        for (float f : {c.position.x, c.position.y, c.position.z, c.target.x, c.target.y, c.target.z, c.up.x, c.up.y, c.up.z, c.fovy}) {
+            w.Put<float>(f);
+        }
+        w.Put<int32_t>(c.projection);
+        w.Put<Color>(s.clear_color);
+        w.PutString(s.model);
+        w.Put<int32_t>(s.instance_count);
+        w.Put<int32_t>(s.instance_layout);
+        w.Put<float>(s.instance_spacing);
+        w.Put<uint32_t>(s.uniforms.size());
+        for (auto& u : s.uniforms) {
+            w.PutString(u.name);
+            w.Put<int32_t>(u.type);
+            if (u.type == SAMPLER2D) {
+                w.PutString(u.image);
+            } else {
+                w.Put<uint8_t>(u.value.isSet);
+                w.data.append((const char*)u.value.v, sizeof(u.value.v));
+            }
+        }
+    }
+    return w.data;
+}
+
+bool FromBinary(const std::string& data, std::vector<ShaderSnapshot>& shaders) {
+    BinaryReader r(data);
+    if (r.Get<uint32_t>() != WORKSPACE_BINARY_MAGIC || r.Get<uint32_t>() != WORKSPACE_BINARY_VERSION) {
+        return false;
+    }
+    uint32_t count = r.Get<uint32_t>();
+    std::vector<ShaderSnapshot> read;
+    for (uint32_t i=0; i<count && r.ok; i++) {
+        ShaderSnapshot s;
+        Camera3D& c = s.camera;
+        s.filename = r.GetString();
+        s.id = r.Get<int32_t>();
+        s.width = r.Get<int32_t>();
+        s.height = r.Get<int32_t>();
+        for (float* f : {&c.position.x, &c.position.y, &c.position.z, &c.target.x, &c.target.y, &c.target.z, &c.up.x, &c.up.y, &c.up.z, &c.fovy}) {
+            *f = r.Get<float>();
+        }
+        c.projection = r.Get<int32_t>();
+        s.clear_color = r.Get<Color>();
+        s.model = r.GetString();
+        s.instance_count = r.Get<int32_t>();
+        s.instance_layout = r.Get<int32_t>();
+        s.instance_spacing = r.Get<float>();
+        uint32_t uniform_count = r.Get<uint32_t>();
+        for (uint32_t j=0; j<uniform_count && r.ok; j++) {
+            SavedUniform u;
+            u.name = r.GetString();
+            u.type = (ShaderUniformType)r.Get<int32_t>();
+            u.value = {0};
+            if (u.type == SAMPLER2D) {
+                u.image = r.GetString();
+            } else {
+                u.value.isSet = r.Get<uint8_t>() != 0;
+                for (int k=0; k<4; k++) {
+                    u.value.iv[k] = r.Get<int32_t>();
+                }
+            }
+            s.uniforms.push_back(std::move(u));
+        }
+        read.push_back(std::move(s));
+    }
+    if (!r.ok) {
+        return false;
+    }
+    shaders.insert(shaders.end(), read.begin(), read.end());
+    return true;
+}
+
+std::string BinaryPath(const std::string& path) {
+    std::filesystem::path p(path);
+    if (p.extension() == ".bin") {
+        return path + ".bin";
+    }
+    return p.replace_extension(".bin").string();
+}
+
+bool Read(const std::string& path, std::vector<ShaderSnapshot>& shaders) {
+    std::string binary_path = BinaryPath(path);
+    std::error_code err;
+    auto json_time = std::filesystem::last_write_time(path, err);
+    bool have_json = !err;
+    auto binary_time = std::filesystem::last_write_time(binary_path, err);
+    bool have_binary = !err;
+    // the json file wins if it was edited after the last save
+    if (have_binary && (!have_json || binary_time >= json_time)) {
+        std::ifstream fd(binary_path, std::ios::in | std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(fd)), std::istreambuf_iterator<char>());
+        if (FromBinary(data, shaders)) {
+            return true;
+        }
+        TraceLog(LOG_WARNING, "Workspace index %s is invalid, loading %s instead", binary_path.c_str(), path.c_str());
+    }
+    if (!have_json) {
+        return false;
+    }
+    std::ifstream fd(path);
+    nlohmann::json json;
+    try {
+        fd >> json;
+    } catch (std::exception& err) {
+        TraceLog(LOG_WARNING, "Failed to load json from file %s: %s", path.c_str(), err.what());
+        return false;
+    }
+    return FromJson(json, shaders);
+}
+
+}
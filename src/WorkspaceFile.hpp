@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <raylib.h>
+
+#include "PixelShader.hpp"
+#include "nlohmann/json.hpp"
+
+// Everything about a shader window that goes into the workspace file.
+typedef struct {
+    std::string filename;
+    int id;
+    int width, height;
+    Camera3D camera;
+    Color clear_color;
+    std::string model;
+    int instance_count;
+    int instance_layout;
+    float instance_spacing;
+    std::vector<SavedUniform> uniforms;
+} ShaderSnapshot;
+
+// Workspace files in both formats.
+// The json file is the one meant to be read and edited by hand, the binary one next to it (workspace.bin for
+// workspace.json) holds the same shaders in a compact form that can be read without a json parser, and is
+// preferred when loading unless the json file has been changed since.
+namespace WorkspaceFile {
+    ShaderSnapshot Snapshot(PixelShader* ps);
+    nlohmann::json ToJson(const std::vector<ShaderSnapshot>& shaders);
+    bool FromJson(const nlohmann::json& json, std::vector<ShaderSnapshot>& shaders);
+    std::string ToBinary(const std::vector<ShaderSnapshot>& shaders);
+    bool FromBinary(const std::string& data, std::vector<ShaderSnapshot>& shaders);
+    std::string BinaryPath(const std::string& path);
+    // Read the shaders of the workspace at path (the json one) from whichever of the two files is current.
+    bool Read(const std::string& path, std::vector<ShaderSnapshot>& shaders);
+}
@@ -0,0 +1,122 @@
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "WorkspaceWriter.hpp"
+
+namespace WorkspaceWriter {
+
+std::map<std::string, std::vector<ShaderSnapshot>> queued;
+// the shaders each file was last saved with, to skip saves that wouldn't change it (only used by the worker)
+std::map<std::string, std::string> written;
+std::mutex mutex;
+std::condition_variable cv;
+std::thread worker;
+bool stopping = false;
+
+// the workspace file as it is on disk, so keys other than "shaders" survive a save
+nlohmann::json ReadDocument(const std::string& path) {
+    std::ifstream fd(path, std::ios::in | std::ios::binary);
+    if (!fd.is_open()) {
+        return nlohmann::json::object();
+    }
+    nlohmann::json json = nlohmann::json::parse(fd, nullptr, false);
+    return json.is_object() ? json : nlohmann::json::object();
+}
+
+// write to a temporary file and rename it over the target, so a crash leaves either the old or the new file
+bool WriteAtomic(const std::string& path, const std::string& text) {
+    std::string tmp = path + ".tmp";
+    FILE* fd = fopen(tmp.c_str(), "wb");
+    if (fd == nullptr) {
+        TraceLog(LOG_WARNING, "Failed to open %s for writing", tmp.c_str());
+        return false;
+    }
+    bool ok = fwrite(text.data(), 1, text.size(), fd) == text.size();
+    ok = fflush(fd) == 0 && ok;
+#ifdef WIN32
+    ok = _commit(_fileno(fd)) == 0 && ok;
+#else
+    ok = fsync(fileno(fd)) == 0 && ok;
+#endif
+    ok = fclose(fd) == 0 && ok;
+    if (!ok) {
+        TraceLog(LOG_WARNING, "Failed to write workspace to %s", tmp.c_str());
+        remove(tmp.c_str());
+        return false;
+    }
+    std::error_code err;
+    std::filesystem::rename(tmp, path, err);
+    if (err) {
+        TraceLog(LOG_WARNING, "Failed to replace %s: %s", path.c_str(), err.message().c_str());
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+void Run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [] { return stopping || !queued.empty(); });
+        if (queued.empty()) {
+            break;
+        }
+        auto it = queued.begin();
+        std::string path = it->first;
+        std::vector<ShaderSnapshot> shaders = std::move(it->second);
+        queued.erase(it);
+        lock.unlock();
+
+        nlohmann::json json = WorkspaceFile::ToJson(shaders);
+        std::string text = json.dump();
+        auto w = written.find(path);
+        if (w == written.end() || w->second != text) {
+            nlohmann::json document = ReadDocument(path);
+            document["shaders"] = std::move(json);
+            // the binary file goes second so it is never older than the json one it was saved with
+            if (WriteAtomic(path, document.dump()) && WriteAtomic(WorkspaceFile::BinaryPath(path), WorkspaceFile::ToBinary(shaders))) {
+                TraceLog(LOG_DEBUG, "Saved workspace to %s", path.c_str());
+                written[path] = std::move(text);
+            }
+        }
+        lock.lock();
+    }
+}
+
+void Start() {
+    stopping = false;
+    worker = std::thread(Run);
+}
+
+void Save(std::string path, std::vector<ShaderSnapshot> shaders) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued[path] = std::move(shaders);
+    }
+    cv.notify_one();
+}
+
+void Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+}
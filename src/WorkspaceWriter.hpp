@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "WorkspaceFile.hpp"
+
+// Saves workspaces from a worker thread.
+// The render thread only copies plain values out of the shaders (WorkspaceFile::Snapshot), encoding and
+// writing both the json and binary files happens on the worker. Files are replaced atomically (written next
+// to the target and renamed over it) and a save whose contents match what was last written is skipped.
+// Only the "shaders" key of the json file is replaced, anything else in it is kept.
+namespace WorkspaceWriter {
+    void Start();
+    // Queue a save, replacing a save of the same file that hasn't started yet.
+    void Save(std::string path, std::vector<ShaderSnapshot> shaders);
+    // Finish any queued saves and stop the worker.
+    void Shutdown();
+}
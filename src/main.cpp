@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdarg>
 #include <cstdlib>
 #include <cstring>
@@ -14,8 +15,22 @@
 #include <external/glad.h>
 
 #include "PixelShader.hpp"
+#include "AnimatedTexture.hpp"
+#include "ControlServer.hpp"
 #include "FileDialogs.hpp"
+#include "FileIndex.hpp"
+#include "FileWatcher.hpp"
+#include "FrameClock.hpp"
 #include "JsonConfig.hpp"
+#include "LogBuffer.hpp"
+#include "LogWriter.hpp"
+#include "MemoryTracker.hpp"
+#include "ModelCache.hpp"
+#include "RenderTargetPool.hpp"
+#include "ResourceLoader.hpp"
+#include "ShaderCompiler.hpp"
+#include "Sweep.hpp"
+#include "WorkspaceWriter.hpp"
 #include "nlohmann/json.hpp"
 
 #define AUTO_SAVE_INTERVAL 60
@@ -23,31 +38,33 @@ PixelShader* pixelShaderReference = nullptr;
 std::map<int, PixelShader*> pixelShaders;
 FileDialogs::FileDialogManager fileDialogManager;
 int default_rt_width = 512;
-std::vector<std::string> log_lines;
-std::ofstream __log_fd;
-
+LogBuffer log_buffer;
+LogWindow log_window;
+// shaders read from the workspace that haven't been loaded yet, by id
+std::map<int, ShaderSnapshot> pendingShaders;
+// bumped whenever something saved in the workspace may have changed, autosave skips snapshotting while it hasn't
+uint64_t workspace_generation = 0;
+extern unsigned int numLoadedShadersEver;
 void __TraceLogCallback(int level, const char* s, va_list args) {
-    const int buffer_size = 512;
-    const std::vector<const char*> log_levels {
-        "TRACE",
-        "DEBUG",
-        "INFO",
-        "WARNING",
-        "ERROR",
-        "FATAL",
-    };
-    TraceLogCallback a;
-    std::string str;
-    char buf[buffer_size];
-    str.reserve(buffer_size+8);
-    snprintf(buf, buffer_size, "[%s] ", log_levels[level - 1]);
-    str.assign(buf);
-    vsnprintf(buf, buffer_size, s, args);
-    str.append(buf);
-    log_lines.push_back(str);
-    printf("%s\n", str.c_str());
-    str.append("\n");
-    __log_fd.write(str.c_str(), str.length());
+    char buf[LOG_WRITER_MESSAGE];
+    int length = vsnprintf(buf, sizeof(buf), s, args);
+    length = length < 0 ? 0 : std::min(length, (int)sizeof(buf) - 1);
+    // raylib may log from texture decoder threads as well as the main thread, neither of these blocks on I/O
+    log_buffer.Push(level, buf, length);
+    LogWriter::Write(level, buf, length);
+    if (level == LOG_FATAL) {
+        // raylib exits right after reporting a fatal error
+        LogWriter::Flush();
+    }
+}
+
+int AddPixelShader(PixelShader* ps) {
+    ps->Setup(default_rt_width, default_rt_width);
+    if (ps->IsReady()) {
+        pixelShaders.insert(std::make_pair(ps->num, ps));
+        return ps->num;
+    }
+    return -1;
 }
 
 int LoadPixelShader(std::string file, int id=-1) {
@@ -58,12 +75,7 @@ int LoadPixelShader(std::string file, int id=-1) {
     } else {
         ps = new PixelShader(file.c_str(), id);
     }
-    ps->Setup(default_rt_width, default_rt_width);
-    if (ps->IsReady()) {
-        pixelShaders.insert(std::make_pair(ps->num, ps));
-        return ps->num;
-    }
-    return -1;
+    return AddPixelShader(ps);
 }
 
 bool NewPixelShader(std::string file) {
@@ -79,112 +91,357 @@ bool NewPixelShader(std::string file) {
     return false;
 }
 
-template<class T>
-void LoadFloatArray(nlohmann::json json, T& dest) {
-    if (!json.is_array()) {
-        return;
+// sampler values naming an image file, as opposed to colors, shader outputs and animated sources
+bool IsImageFile(const std::string& value) {
+    return value.size() > 0 && value[0] != '(' && value.compare(0, 4, "rgb(") != 0 && value.compare(0, 5, "rgba(") != 0
+        && !IsAnimatedTextureSource(value.c_str());
+}
+
+// Start reading, compiling and decoding everything a workspace shader needs before it is loaded.
+void PrefetchSnapshot(const ShaderSnapshot& s) {
+    ResourceLoader::RequestShader(s.id, s.filename);
+    for (auto& u : s.uniforms) {
+        if (u.type == SAMPLER2D && IsImageFile(u.image)) {
+            ResourceLoader::RequestImage(u.image);
+        }
+    }
+    if (s.model.size() > 0) {
+        ModelCache::Request(s.model);
     }
-    memset(&dest, 0, sizeof(dest));
-    for (int i=0; i<json.size(); i++) {
-        if (!json[i].is_number()) {
-            return;
+}
+
+void ReleaseSnapshot(const ShaderSnapshot& s) {
+    ResourceLoader::CancelShader(s.id);
+    for (auto& u : s.uniforms) {
+        if (u.type == SAMPLER2D && IsImageFile(u.image)) {
+            ResourceLoader::ReleaseImage(u.image);
         }
-        if (i*sizeof(float) >= sizeof(dest)) {
-            return;
+    }
+    if (s.model.size() > 0) {
+        ModelCache::Release(s.model);
+    }
+}
+
+bool IsSnapshotReady(const ShaderSnapshot& s) {
+    if (!ResourceLoader::IsShaderReady(s.id)) {
+        return false;
+    }
+    for (auto& u : s.uniforms) {
+        if (u.type == SAMPLER2D && IsImageFile(u.image) && !ResourceLoader::IsImageReady(u.image)) {
+            return false;
         }
-        float val = json[i].get<float>();
-        memcpy((&dest)+i*sizeof(float), &val, sizeof(float));
     }
+    return true;
 }
 
-JsonConfig LoadWorkspace(std::string fname="workspace.json") {
-    JsonConfig workspaceCfg(fname);
-    if (workspaceCfg.contains("shaders")) {
-        auto shaders = workspaceCfg["shaders"];
-        if (shaders.is_object()) {
-            for (auto s : shaders.items()) {
-                std::string fname = s.key();
-                nlohmann::json j = s.value();
-                if (!j.is_object()) continue;
-                int id = LoadPixelShader(fname);
-                if (id != -1) {
-                    PixelShader* ps = pixelShaders[id];
-                    if (j.contains("clear_color") && j["clear_color"].is_array()) {
-                        auto arr = j["clear_color"];
-                        int clearColorI[4] = {0};
-                        for (int i=0; i<arr.size(); i++) {
-                            if (arr[i].is_number_integer()) {
-                                clearColorI[i] = arr[i].get<int>();
-                            }
-                        }
-                    }
-                    if (j.contains("camera") && j["camera"].is_object()) {
-                        auto cam = j["camera"];
-                        if (cam.contains("position") && cam["position"].is_array()) {
-                            LoadFloatArray(cam["position"], ps->camera.position);
-                        }
-                        if (cam.contains("target") && cam["target"].is_array()) {
-                            LoadFloatArray(cam["target"], ps->camera.target);
-                        }
-                        if (cam.contains("up") && cam["up"].is_array()) {
-                            LoadFloatArray(cam["up"], ps->camera.up);
-                        }
-                    }
-                    if (j.contains("model") && j["model"].is_string()) {
-                        ps->LoadModel(j["model"].get<std::string>());
-                    }
-                    if (j.contains("width") && j["width"].is_number()) {
-                        if (j.contains("height") && j["height"].is_number()) {
-                            ps->SetRTSize(j["width"].get<int>(), j["height"].get<int>());
-                        } else {
-                            ps->SetRTSize(j["width"].get<int>(), j["width"].get<int>());
-                        }
-                    }
-                    if (j.contains("uniforms") && j["uniforms"].is_object()) {
-                        ps->LoadUniforms(j["uniforms"]);
-                    }
+PixelShader* LoadShaderSnapshot(const ShaderSnapshot& s) {
+    std::string code;
+    Shader compiled = {0};
+    int id;
+    if (ResourceLoader::TakeShader(s.id, code, compiled)) {
+        id = AddPixelShader(new PixelShader(s.filename.c_str(), s.id, code, compiled));
+    } else {
+        id = LoadPixelShader(s.filename, s.id);
+    }
+    if (id == -1) {
+        return nullptr;
+    }
+    PixelShader* ps = pixelShaders[id];
+    ps->camera = s.camera;
+    ps->clearColor = s.clear_color;
+    if (s.model.size() > 0) {
+        ps->LoadModel(s.model);
+    }
+    ps->instance_count = s.instance_count;
+    ps->instance_layout = s.instance_layout;
+    ps->instance_spacing = s.instance_spacing;
+    ps->instances_dirty = true;
+    if (s.width > 0 && s.height > 0) {
+        ps->SetRTSize(s.width, s.height);
+    }
+    ps->ApplyUniforms(s.uniforms);
+    return ps;
+}
+
+// Get a shader by id, loading it now if it is still pending from the workspace.
+PixelShader* GetPixelShader(int id) {
+    auto it = pixelShaders.find(id);
+    if (it != pixelShaders.end()) {
+        return it->second;
+    }
+    auto p = pendingShaders.find(id);
+    if (p == pendingShaders.end()) {
+        return nullptr;
+    }
+    ShaderSnapshot s = std::move(p->second);
+    pendingShaders.erase(p);
+    PixelShader* ps = LoadShaderSnapshot(s);
+    // the shader holds its own references now
+    ReleaseSnapshot(s);
+    return ps;
+}
+
+// Shaders are only read from the workspace here, they are loaded once their window is visible or their output
+// is referenced, so startup doesn't depend on the size of the workspace.
+void LoadWorkspace(std::string fname="workspace.json") {
+    std::vector<ShaderSnapshot> shaders;
+    WorkspaceFile::Read(fname, shaders);
+    for (auto& s : shaders) {
+        if (s.id >= (int)numLoadedShadersEver) {
+            numLoadedShadersEver = s.id + 1;
+        }
+    }
+    for (auto& s : shaders) {
+        // workspaces saved before ids were kept may be missing them
+        if (s.id < 0 || pendingShaders.count(s.id) > 0) {
+            s.id = numLoadedShadersEver++;
+        }
+        PrefetchSnapshot(s);
+        pendingShaders[s.id] = std::move(s);
+    }
+    TraceLog(LOG_INFO, "Workspace %s has %d shaders", fname.c_str(), (int)pendingShaders.size());
+}
+
+// Stand-in output windows for shaders that haven't been loaded yet.
+// Visible ones are loaded once their resources are in, within a time budget.
+void DrawPendingShaders(float budget) {
+    std::vector<int> visible;
+    for (auto it = pendingShaders.begin(); it != pendingShaders.end();) {
+        bool open = true;
+        std::string title = "Shader " + std::to_string(it->first) + " Output";
+        bool shown = ImGui::Begin(title.c_str(), &open);
+        if (shown) {
+            ImGui::TextDisabled("Loading %s...", it->second.filename.c_str());
+        }
+        ImGui::End();
+        if (!open) {
+            ReleaseSnapshot(it->second);
+            it = pendingShaders.erase(it);
+            continue;
+        }
+        if (shown && IsSnapshotReady(it->second)) {
+            visible.push_back(it->first);
+        }
+        it++;
+    }
+    double start = GetTime();
+    for (int id : visible) {
+        GetPixelShader(id);
+        if (GetTime() - start >= budget) {
+            break;
+        }
+    }
+}
+
+// Watch the files the loaded shaders use and reload only what uses a file that changed.
+void HotReload() {
+    std::vector<std::string> watched;
+    for (auto& p : pixelShaders) {
+        if (p.second != nullptr) {
+            p.second->WatchedFiles(watched);
+        }
+    }
+    FileWatcher::SetFiles(watched);
+    for (auto& path : FileWatcher::Poll()) {
+        workspace_generation++;
+        // shared by every shader using it, the shaders pick up the new one in PollModel
+        ModelCache::Reload(path);
+        for (auto& p : pixelShaders) {
+            if (p.second != nullptr) {
+                p.second->FileChanged(path);
+            }
+        }
+    }
+}
+
+nlohmann::json ControlError(const std::string& message) {
+    return {{"ok", false}, {"error", message}};
+}
+
+// set a uniform of ps from a json value, false if ps has no uniform by that name or the value doesn't fit it
+bool SetUniformFromJson(PixelShader* ps, const std::string& name, const nlohmann::json& value) {
+    auto loc = ps->shader_locs.find(name);
+    if (loc == ps->shader_locs.end()) {
+        return false;
+    }
+    ShaderUniformType type = loc->second.second;
+    if (type == SAMPLER2D) {
+        if (!value.is_string()) return false;
+        std::string image = value.get<std::string>();
+        ps->SetUniform(name, type, (void*)image.c_str());
+        return true;
+    }
+    Uniform u = {0};
+    if (type == INT) {
+        if (!value.is_number()) return false;
+        u.i = value.get<int>();
+    } else if (value.is_number()) {
+        u.f = value.get<float>();
+    } else if (value.is_array() && value.size() <= 4) {
+        for (int i=0; i<(int)value.size(); i++) {
+            if (!value[i].is_number()) return false;
+            u.v[i] = value[i].get<float>();
+        }
+    } else {
+        return false;
+    }
+    ps->SetUniform(name, type, u.v);
+    return true;
+}
+
+// Run a request from ControlServer. Requests name shaders by the id "load" and "list" give back.
+nlohmann::json RunControlCommand(int client, const nlohmann::json& request) {
+    if (!request.is_object() || !request.contains("cmd") || !request["cmd"].is_string()) {
+        return ControlError("expected a json object with a \"cmd\"");
+    }
+    std::string cmd = request["cmd"].get<std::string>();
+    if (cmd == "list") {
+        nlohmann::json shaders = nlohmann::json::array();
+        for (auto& p : pixelShaders) {
+            if (p.second != nullptr) {
+                shaders.push_back({{"shader", p.first}, {"file", p.second->filename}, {"width", p.second->rt_width},
+                    {"height", p.second->rt_height}, {"uniforms", p.second->DumpUniforms()}});
+            }
+        }
+        return {{"ok", true}, {"shaders", shaders}};
+    }
+    if (cmd == "memory") {
+        nlohmann::json response = MemoryTracker::Dump();
+        response["ok"] = true;
+        return response;
+    }
+    if (cmd == "load") {
+        if (!request.contains("file") || !request["file"].is_string()) {
+            return ControlError("load needs a \"file\"");
+        }
+        int id = LoadPixelShader(request["file"].get<std::string>());
+        if (id == -1) {
+            return ControlError("failed to load " + request["file"].get<std::string>());
+        }
+        return {{"ok", true}, {"shader", id}};
+    }
+    if (!request.contains("shader") || !request["shader"].is_number_integer()) {
+        return ControlError(cmd + " needs a \"shader\" id");
+    }
+    PixelShader* ps = GetPixelShader(request["shader"].get<int>());
+    if (ps == nullptr) {
+        return ControlError("no shader " + request["shader"].dump());
+    }
+    if (cmd == "unload") {
+        ps->Unload();
+        pixelShaders[ps->num] = nullptr;
+        return {{"ok", true}};
+    }
+    if (cmd == "set") {
+        nlohmann::json ignored = nlohmann::json::array();
+        if (request.contains("size") && request["size"].is_array() && request["size"].size() == 2 &&
+            request["size"][0].is_number_integer() && request["size"][1].is_number_integer()) {
+            int w = request["size"][0].get<int>(), h = request["size"][1].get<int>();
+            if (w > 0 && h > 0 && (w != ps->rt_width || h != ps->rt_height)) {
+                ps->SetRTSize(w, h);
+            }
+        }
+        if (request.contains("publish") && request["publish"].is_boolean()) {
+            ps->PublishFrames(request["publish"].get<bool>());
+        }
+        if (request.contains("uniforms") && request["uniforms"].is_object()) {
+            for (auto& u : request["uniforms"].items()) {
+                if (!SetUniformFromJson(ps, u.key(), u.value())) {
+                    ignored.push_back(u.key());
                 }
             }
         }
+        nlohmann::json response = {{"ok", true}, {"ignored", ignored}};
+        if (ps->frame_ring != nullptr) {
+            response["publish"] = ps->frame_ring->name;
+        }
+        return response;
+    }
+    if (cmd == "render") {
+        if (!ps->IsReady()) {
+            return ControlError("shader " + request["shader"].dump() + " isn't compiled");
+        }
+        int frames = request.contains("frames") && request["frames"].is_number_integer() ? request["frames"].get<int>() : 1;
+        if (frames < 1 || frames > CONTROL_SERVER_MAX_FRAMES) {
+            return ControlError("frames has to be between 1 and " + std::to_string(CONTROL_SERVER_MAX_FRAMES));
+        }
+        float dt = request.contains("dt") && request["dt"].is_number() ? request["dt"].get<float>() : 1.0f / 60.0f;
+        for (int i=0; i<frames; i++) {
+            ps->Update(dt);
+        }
+        // Update swaps the frame it just drew into selfTexture
+        RenderTexture2D& frame = ps->selfTexture;
+        nlohmann::json response = {{"ok", true}, {"frame", ps->frame_counter}, {"time", ps->runtime},
+            {"width", frame.texture.width}, {"height", frame.texture.height}};
+        if (request.contains("output") && request["output"].is_string()) {
+            std::string output = request["output"].get<std::string>();
+            Image img = LoadImageFromTexture(frame.texture);
+            ImageFlipVertical(&img);
+            if (IsFileExtension(output.c_str(), ".jpg") || IsFileExtension(output.c_str(), ".jpeg")) {
+                ImageFormat(&img, PIXELFORMAT_UNCOMPRESSED_R8G8B8);
+            }
+            bool ok = ExportImage(img, output.c_str());
+            UnloadImage(img);
+            if (!ok) {
+                return ControlError("failed to write " + output);
+            }
+            response["output"] = output;
+        }
+        if (request.value("pixels", false)) {
+            size_t size = (size_t)frame.texture.width * frame.texture.height * 4;
+            SharedMemory* shm = ControlServer::Pixels(client, size);
+            if (shm == nullptr) {
+                return ControlError("no shared memory for the pixels");
+            }
+            // read straight into the client's mapping, rows bottom to top as GL keeps them
+            rlEnableFramebuffer(frame.id);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, frame.texture.width, frame.texture.height, GL_RGBA, GL_UNSIGNED_BYTE, shm->Data());
+            rlDisableFramebuffer();
+            response["shm"] = shm->Name();
+            response["size"] = size;
+            response["format"] = "rgba8";
+            response["origin"] = "bottom-left";
+        }
+        return response;
+    }
+    return ControlError("unknown cmd " + cmd);
+}
+
+void RunControlCommands() {
+    for (auto& c : ControlServer::Poll()) {
+        workspace_generation++;
+        nlohmann::json response = c.request.is_discarded() ? ControlError("invalid json") : RunControlCommand(c.client, c.request);
+        if (c.request.is_object() && c.request.contains("id")) {
+            response["id"] = c.request["id"];
+        }
+        ControlServer::Reply(c.client, response);
     }
-    return workspaceCfg;
 }
 
-void SaveWorkspace(JsonConfig& cfg) {
-    nlohmann::json json;
+std::vector<ShaderSnapshot> SnapshotWorkspace() {
+    std::vector<ShaderSnapshot> shaders;
     for (auto p : pixelShaders) {
-        auto ps = p.second;
-        if (ps == nullptr) continue;
-        nlohmann::json j = ps->DumpUniforms();
-        Camera3D c = ps->camera;
-        j = {
-            {"uniforms", j},
-            {"width", ps->rt_width},
-            {"height", ps->rt_height},
-            {"id", ps->num},
-            {"camera", {
-                "position", nlohmann::json::array({c.position.x, c.position.y, c.position.z}),
-                "target", nlohmann::json::array({c.target.x, c.target.y, c.target.z}),
-                "up", nlohmann::json::array({c.up.x, c.up.y, c.up.z}),
-            }},
-            {"clear_color", nlohmann::json::array({ps->clearColor.r, ps->clearColor.g, ps->clearColor.b, ps->clearColor.a})},
-        };
-        if (ps->modelFilebuf != nullptr && ps->modelFilebuf[0] > 0) {
-            j["model"] = std::string(ps->modelFilebuf);
-        }
-        json[std::string(ps->filename)] = j;
-    }
-    cfg["shaders"] = json;
-    cfg.save();
+        if (p.second != nullptr) {
+            shaders.push_back(WorkspaceFile::Snapshot(p.second));
+        }
+    }
+    for (auto& p : pendingShaders) {
+        shaders.push_back(p.second);
+    }
+    return shaders;
+}
+
+void SaveWorkspace(std::string fname="workspace.json") {
+    WorkspaceWriter::Save(fname, SnapshotWorkspace());
 }
 
 class WorkspaceSaveAsCB : public FileDialogs::Callback {
-    JsonConfig workspaceCfg;
     public:
-    WorkspaceSaveAsCB(JsonConfig workspaceCfg) : workspaceCfg(workspaceCfg) {}
     bool operator()(std::string fname) {
         if (fname.size() < 1) return false;
-        return workspaceCfg.save(fname);
+        SaveWorkspace(fname);
+        return true;
     }
 };
 
@@ -207,6 +464,8 @@ class NewPixelShaderCB : public FileDialogs::Callback {
 int main(int argc, char** argv) {
     bool debug = false;
     char pixel_shader_file[IMAGE_NAME_BUFFER_LENGTH] = "shaders/noise.fs";
+    const char* sweep_job = nullptr;
+    const char* control_socket = nullptr;
     for (int i=1; i<argc; i++) {
         if (!strcmp(argv[i], "--debug")) {
             debug = true;
@@ -216,30 +475,53 @@ int main(int argc, char** argv) {
         } else if (!strcmp(argv[i], "-f") || !strcmp(argv[i], "--file")) {
             if (i+1 < argc)
                 strcpy(pixel_shader_file, argv[i+1]);
+        } else if (!strcmp(argv[i], "--sweep")) {
+            if (i+1 < argc)
+                sweep_job = argv[i+1];
+        } else if (!strcmp(argv[i], "--control")) {
+            if (i+1 < argc)
+                control_socket = argv[i+1];
         }
     }
 
-    __log_fd.open("debug.log");
+    LogWriter::Start("debug.log");
     SetTraceLogCallback(__TraceLogCallback);
+    MemoryTracker::Track(MEMORY_LOG, 0, log_buffer.Bytes(), MEMORY_NO_OWNER, "debug log");
     if (debug) {
         SetTraceLogLevel(LOG_TRACE);
     }
 
+    if (sweep_job != nullptr) {
+        // render the contact sheet and exit, the window is only there for the GL context
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+        InitWindow(1, 1, "PixelShaderTestBench");
+        bool ok = Sweep::RunFile(sweep_job);
+        RenderTargetPool::Trim();
+        ModelCache::Shutdown();
+        CloseWindow();
+        LogWriter::Shutdown();
+        return ok ? 0 : 1;
+    }
+
     SetConfigFlags(FLAG_VSYNC_HINT | FLAG_WINDOW_RESIZABLE);
     InitWindow(1000, 600, "PixelShaderTestBench");
-    SetTargetFPS(60);
+    // frames are paced by the clocks in the main loop, not by EndDrawing
+    SetTargetFPS(0);
     SetExitKey(-1);
+    // default render rate of shaders without their own, and the rate the UI is drawn at (-1 for unlimited)
     int render_texture_update_rate = 30;
-    float render_texture_update_timer = 0;
     bool autosave_workspace = true;
     float auto_save_timer = 0;
     float auto_save_interval = AUTO_SAVE_INTERVAL;
-    bool scroll_log_to_bottom = true;
+    uint64_t autosaved_generation = 0;
     float dt = 0.0f;
     int frame_counter = 0;
     int target_fps = 60;
+    // vsync is still turned off while the UI FPS is above the display's refresh rate, it would cap the UI at that
+    bool vsync = true;
 
     rlImGuiSetup(true);
+    ShaderCompiler::Init();
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
     io.ConfigFlags |= ImGuiConfigFlags_NoMouseCursorChange;
@@ -269,26 +551,82 @@ int main(int argc, char** argv) {
             render_texture_update_rate = 1;
         }
     }
+    if (preferencesCfg.contains("gpu_budget_mb")) {
+        MemoryTracker::SetGPUBudget((size_t)preferencesCfg.get<int>("gpu_budget_mb") << 20);
+    }
+    if (preferencesCfg.contains("vsync")) {
+        vsync = preferencesCfg.get<bool>("vsync");
+    }
     if (preferencesCfg.contains("target_fps")) {
         target_fps = preferencesCfg.get<float>("target_fps");
-        if (target_fps < 10) {
+        if (target_fps < 10 && target_fps != -1) {
             target_fps = 10;
         }
     }
 
-    JsonConfig workspaceCfg = LoadWorkspace();
+    LoadWorkspace();
+    WorkspaceWriter::Start();
+    FileIndex::Start();
+    FileWatcher::Start();
+    if (control_socket != nullptr) {
+        ControlServer::Start(control_socket);
+    }
 
+    FrameClock ui_clock(target_fps);
     while (!WindowShouldClose()) {
-        BeginDrawing();
-        if (render_texture_update_timer >= 1.0 / render_texture_update_rate) {
-            render_texture_update_timer -= 1.0 / render_texture_update_rate;
+        ModelCache::Poll(0.004f);
+        // before anything draws, a model the cache reloaded is freed on its next Poll
+        for (auto p : pixelShaders) {
+            if (p.second != nullptr) {
+                p.second->Poll();
+            }
+        }
+        ResourceLoader::Poll();
+        FileIndex::SetRoots(FileDialogs::GetPinnedFolders());
+        HotReload();
+        RunControlCommands();
+        // every shader renders on its own fixed timestep clock, however often the UI is drawn
+        double now = GetTime();
+        for (auto p : pixelShaders) {
+            auto ps = p.second;
+            if (ps == nullptr) {
+                continue;
+            }
+            ps->clock.rate = ps->render_rate > 0 ? ps->render_rate : render_texture_update_rate;
+            if (!ps->IsReady()) {
+                ps->clock.Reset(now);
+                continue;
+            }
+            int ticks = ps->clock.Advance(now);
+            for (int i=0; i<ticks; i++) {
+                ps->Update(ps->clock.Interval());
+            }
+        }
+        ui_clock.rate = target_fps;
+        if (target_fps > 0 && ui_clock.Advance(GetTime()) == 0) {
+            // nothing to draw yet, sleep until the UI or a shader is due
+            double next = ui_clock.Next();
             for (auto p : pixelShaders) {
-                auto ps = p.second;
-                if (ps != nullptr && ps->IsReady()) {
-                    ps->Update(dt * target_fps / (float)render_texture_update_rate);
+                if (p.second != nullptr && p.second->IsReady()) {
+                    next = std::min(next, p.second->clock.Next());
                 }
             }
+            double wait = next - GetTime();
+            if (wait > 0) {
+                WaitTime(wait);
+            }
+            continue;
         }
+        int refresh_rate = GetMonitorRefreshRate(GetCurrentMonitor());
+        bool want_vsync = vsync && target_fps > 0 && (refresh_rate <= 0 || target_fps <= refresh_rate);
+        if (want_vsync != IsWindowState(FLAG_VSYNC_HINT)) {
+            if (want_vsync) {
+                SetWindowState(FLAG_VSYNC_HINT);
+            } else {
+                ClearWindowState(FLAG_VSYNC_HINT);
+            }
+        }
+        BeginDrawing();
         ClearBackground(BLACK);
         DrawFPS(1, 1);
         rlImGuiBegin();
@@ -309,23 +647,35 @@ int main(int argc, char** argv) {
         if (ImGui::Button("New")) {
             fileDialogManager.openIfNotAlready("BrowseForNewShader", "New Shader", NewPixelShaderCB(), true);
         }
-        ImGui::SliderInt("Target updates per second", &render_texture_update_rate, 1, 60);
-        if (ImGui::SliderInt("Target FPS", &target_fps, 10, 500)) {
-            SetTargetFPS(target_fps);
-        }
+        ImGui::SliderInt("Render rate (Hz)", &render_texture_update_rate, 1, 1000, "%d", ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+        ImGui::SetItemTooltip("Frames per second rendered by shaders that don't set their own rate");
+        ImGui::SliderInt("UI FPS", &target_fps, 10, 500, target_fps > 0 ? "%d" : "unlimited", ImGuiSliderFlags_AlwaysClamp);
         if (ImGui::Button("Unlimited FPS")) {
-            SetTargetFPS((target_fps = -1));
+            target_fps = -1;
         }
+        ImGui::SameLine();
+        ImGui::Checkbox("VSync", &vsync);
+        ImGui::SetItemTooltip("Off while the UI FPS is above the display's refresh rate (%d Hz)", refresh_rate);
         if (ImGui::Button("Save Workspace")) {
-            SaveWorkspace(workspaceCfg);
+            SaveWorkspace();
         }
         ImGui::SameLine();
         if (ImGui::Button("Save As...")) {
-            fileDialogManager.openIfNotAlready("SaveWorkspaceAs", "Save Workspace As", WorkspaceSaveAsCB(workspaceCfg), true);
+            fileDialogManager.openIfNotAlready("SaveWorkspaceAs", "Save Workspace As", WorkspaceSaveAsCB(), true);
         }
         ImGui::SameLine();
         if (ImGui::Checkbox("Autosave", &autosave_workspace)) {}
         if (ImGui::InputFloat("Autosave Interval", &auto_save_interval)) {}
+        {
+            RenderTargetPool::Stats pool = RenderTargetPool::GetStats();
+            ImGui::Text("Render targets: %d in use (%.1f MB), %d idle (%.1f MB), %llu reused / %llu allocated",
+                pool.in_use, pool.in_use_bytes / 1048576.0, pool.idle, pool.idle_bytes / 1048576.0,
+                (unsigned long long)pool.hits, (unsigned long long)pool.misses);
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Trim")) {
+                RenderTargetPool::Trim();
+            }
+        }
         ImGui::End();
 
         // display pixel shader windows, handle unloading/referencing/cloning
@@ -343,33 +693,44 @@ int main(int argc, char** argv) {
                 } else if (ps->requested_reference) { // if the copy reference button was pressed
                     ps->requested_reference = false;
                     pixelShaderReference = ps;
+                } else if (ps->requested_sweep) { // if the run sweep button was pressed
+                    ps->requested_sweep = false;
+                    Sweep::Job job;
+                    if (Sweep::LoadJob(ps->sweep_job, job)) {
+                        Sweep::Run(*ps, job);
+                    }
                 }
             }
         }
+        DrawPendingShaders(0.008f);
         // display active file dialogs
         fileDialogManager.show();
         // display log window
-        ImGui::Begin("Debug Log");
-        for (std::string line : log_lines) {
-            ImGui::Text("%s", line.c_str());
+        log_window.Draw("Debug Log", log_buffer);
+        MemoryTracker::DrawWindow("Memory");
+        // every edit, button and menu item in the windows is active for at least a frame
+        if (ImGui::IsAnyItemActive()) {
+            workspace_generation++;
         }
-        ImGui::Checkbox("Scroll log to bottom", &scroll_log_to_bottom);
-        if (scroll_log_to_bottom) {
-            ImGui::SetScrollY(ImGui::GetScrollMaxY());
+        for (auto& p : pixelShaders) {
+            if (p.second != nullptr && p.second->controlling_camera) {
+                workspace_generation++;
+            }
         }
-        ImGui::End();
 
         rlImGuiEnd();
         EndDrawing();
         dt = GetFrameTime();
-        render_texture_update_timer += dt;
         frame_counter++;
 
         if (autosave_workspace) {
             auto_save_timer += dt;
             if (auto_save_timer >= auto_save_interval) {
                 auto_save_timer -= auto_save_interval;
-                SaveWorkspace(workspaceCfg);
+                if (workspace_generation != autosaved_generation) {
+                    autosaved_generation = workspace_generation;
+                    SaveWorkspace();
+                }
             }
         }
     }
@@ -389,13 +750,25 @@ int main(int argc, char** argv) {
         preferencesCfg.set("autosave_interval", auto_save_interval);
         preferencesCfg.set("update_rate", render_texture_update_rate);
         preferencesCfg.set("target_fps", target_fps);
+        preferencesCfg.set("vsync", vsync);
+        preferencesCfg.set("gpu_budget_mb", (int)(MemoryTracker::GetGPUBudget() >> 20));
         preferencesCfg.save();
     }
 
-    SaveWorkspace(workspaceCfg);
-    __log_fd.close();
+    SaveWorkspace();
+    WorkspaceWriter::Shutdown();
+    FileDialogs::StopDirectoryScans();
+    FileIndex::Shutdown();
+    FileWatcher::Shutdown();
+    ControlServer::Shutdown();
+    ResourceLoader::Shutdown();
+    RenderTargetPool::Trim();
+    ModelCache::Shutdown();
+    ShaderCompiler::Shutdown();
 
     rlImGuiShutdown();
     CloseWindow();
+    // last, so what CloseWindow logs still goes out through the writer
+    LogWriter::Shutdown();
     return 0;
 }